@@ -0,0 +1,1087 @@
+/*
+ *  FILENAME:      bench.cpp
+ *
+ *  DESCRIPTION:
+ *      Headless benchmark of the simulation core (Model, Map, Chunk, entities, filesystem)
+ *
+ *  NOTES:
+ *      Every scenario runs in its own empty map folder below the work directory (-d), so results don't depend on earlier runs.
+ *      Scenarios:
+ *        tracked   N tracked entities (-n) walking across the map, every chunk border crossing streams chunks
+ *                  (on the fresh map they are generated, "generated" counts them, "chunks in/s" is loads plus generated)
+ *        physics   M physics entities per ticked chunk (-m) pushed around around a single tracked entity
+ *        churn     one tracked entity jumping between two areas each tick, every tick unloads one area and brings the other back.
+ *                  Unchanged chunks aren't written again, chunks that hold nothing but generated terrain come back from the
+ *                  GenerationCache ("gen cached") and only the painted ones are loaded from disk
+ *        autosave  -m entities per chunk around a single tracked entity, one of them moving, the map autosaves every 60 ticks
+ *        replay    a session recorded with "blub -r" (-r), as fast as possible, optionally on a copy of the recorded map (-i)
+ *                  prints tick percentiles, -c writes every tick duration as csv
+ *        codec     compress/decompress throughput and size of chunk data per codec, using the chunks of -i or generated ones
+ *                  (a few sparsely painted tileset layers and -m entities per chunk)
+ *        generate  chunks generated per second by the terrain generator, on one thread and on all cores
+ *        noise     2D simplex samples per second, one call per sample against the batch functions, and how many results differ
+ *                  (any difference makes blub_bench exit with a failure)
+ *        tilemap   compares the tilemap shader's lookup (tilemap::atlasCoord) with drawing single tiles for every tile index
+ *                  and rotation, the mismatch count has to be 0 or blub_bench exits with a failure
+ *        gamelayer compares the game layer's bit-plane queries (GameLayer::mask, CellMask::intersects, Map::anyGamelayerInBox,
+ *                  Map::firstGamelayerInRow/Column) with reading the cells one by one, around and below chunk 0,0.
+ *                  Any mismatch makes blub_bench exit with a failure
+ *
+ *      -z none|lz4 overrides the chunk codec of the benchmarked map
+ *
+ *      usage: blub_bench [-s scenario] [-t ticks] [-n entities] [-m entities per chunk] [-z codec] [-d workdir] [-p trace.json]
+ *             blub_bench -r session.rpl [-i mapdir] [-c ticks.csv] [-z codec] [-d workdir] [-p trace.json]
+ *
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <getopt.h>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "game/global.h"
+#include "game/profiler.h"
+#include "game/replay.h"
+#include "game/simplexnoise.h"
+#include "logic/model.h"
+#include "logic/tilemap.h"
+
+namespace
+{
+  struct Options
+  {
+    std::string scenario = "all";
+    std::string workDir;
+    std::string traceFile;
+    std::string replayFile;
+    std::string mapDir;
+    std::string tickCsv;
+    std::optional<compression::Codec> codec;
+    uint32_t ticks = 1000;
+    uint32_t entities = 4;
+    uint32_t entitiesPerChunk = 32;
+  };
+
+  struct Result
+  {
+    std::string name;
+    uint32_t ticks;
+    double tickSeconds;
+    double shutdownSeconds;
+    uint64_t chunkLoads;
+    uint64_t chunksGenerated;
+    uint64_t generatedCached;
+    uint64_t chunkSaves;
+    uint64_t deltaSaves;
+    uint64_t bytesWritten;
+    uint64_t bytesRead;
+  };
+
+  // snapshot of all global counters, scenarios report the difference
+  struct Counters
+  {
+    uint64_t loads;
+    uint64_t generated;
+    uint64_t generatedCached;
+    uint64_t saves;
+    uint64_t deltaSaves;
+    uint64_t bytesWritten;
+    uint64_t bytesRead;
+
+    static Counters now()
+    {
+      return Counters {
+        Chunk::stats.loads.load(),
+        Chunk::stats.generated.load(),
+        Chunk::stats.generatedCached.load(),
+        Chunk::stats.saves.load(),
+        Chunk::stats.deltaSaves.load(),
+        filesystem::stats.bytesWritten.load(),
+        filesystem::stats.bytesRead.load()
+      };
+    }
+  };
+
+  using Clock = std::chrono::steady_clock;
+
+  double secondsSince(Clock::time_point start)
+  {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+  }
+
+  // fresh map folder as working directory, Map and Chunk use relative paths
+  void enterWorkDir(const std::filesystem::path& base, const std::string& scenario)
+  {
+    auto dir = base / scenario;
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir / "data/map/chunks");
+    std::filesystem::current_path(dir);
+  }
+
+  // a damaged map can't be benchmarked, prints why
+  bool mapUsable(Model& model)
+  {
+    auto* map = model.getMap();
+    if (map->getLoadResult() != Map::LoadResult::Damaged)
+    {
+      return true;
+    }
+    auto path = map->getDataFilePath();
+    fprintf(stderr, "[MAP] %s is damaged and kept as %s.damaged\n", path.c_str(), path.c_str());
+    return false;
+  }
+
+  void tick(Model& model)
+  {
+    model.tick();
+    global::tickCount++;
+  }
+
+  template<typename Setup, typename Step>
+  Result run(const std::string& name, const Options& options, const std::filesystem::path& base, Setup&& setup, Step&& step)
+  {
+    enterWorkDir(base, name);
+
+    global::tickCount = 0;
+    global::lastTickDuration = 1.f / 60.f;
+
+    Result result { name, options.ticks, 0., 0., 0, 0, 0, 0, 0, 0, 0 };
+    auto* model = new Model();
+    if (options.codec)
+    {
+      model->getMap()->setChunkCodec(*options.codec);
+    }
+
+    setup(*model);
+
+    auto before = Counters::now();
+    auto start = Clock::now();
+
+    for (auto i = 0u; i < options.ticks; i++)
+    {
+      step(*model, i);
+      tick(*model);
+    }
+
+    result.tickSeconds = secondsSince(start);
+
+    // destroying the model flushes all loaded chunks and the map data
+    start = Clock::now();
+    delete model;
+    result.shutdownSeconds = secondsSince(start);
+
+    auto after = Counters::now();
+    result.chunkLoads   = after.loads - before.loads;
+    result.chunksGenerated = after.generated - before.generated;
+    result.generatedCached = after.generatedCached - before.generatedCached;
+    result.chunkSaves   = after.saves - before.saves;
+    result.deltaSaves   = after.deltaSaves - before.deltaSaves;
+    result.bytesWritten = after.bytesWritten - before.bytesWritten;
+    result.bytesRead    = after.bytesRead - before.bytesRead;
+
+    return result;
+  }
+
+  Result tracked(const Options& options, const std::filesystem::path& base)
+  {
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> angle(0.f, 6.2831853f);
+
+    std::vector<std::shared_ptr<Entity>> entities;
+    std::vector<game::vec2<float>> velocities;
+
+    return run("tracked", options, base,
+      [&](Model& model) -> void
+      {
+        for (auto i = 0u; i < options.entities; i++)
+        {
+          // spread the start positions so entities only share some of their chunks
+          auto start = game::vec2<float>(i * 40.f + 8.f, 8.f);
+          auto dir = angle(rng);
+
+          entities.push_back(std::make_shared<Entity>(start, game::vec2<float>(1.f, 1.f), game::vec2<float>(.5f, .5f), model.getMap()->getNextEntityId()));
+          velocities.push_back(game::vec2<float>(std::cos(dir), std::sin(dir)) * 0.25f);
+
+          model.addEntity(entities.back(), true);
+        }
+      },
+      [&](Model&, uint32_t) -> void
+      {
+        for (auto i = 0u; i < entities.size(); i++)
+        {
+          entities[i]->modXY(velocities[i]);
+        }
+      }
+    );
+  }
+
+  Result physics(const Options& options, const std::filesystem::path& base)
+  {
+    std::mt19937 rng(4321);
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
+
+    std::shared_ptr<Entity> anchor;
+
+    return run("physics", options, base,
+      [&](Model& model) -> void
+      {
+        auto* map = model.getMap();
+        anchor = std::make_shared<Entity>(game::vec2<float>(8.f, 8.f), game::vec2<float>(1.f, 1.f), game::vec2<float>(.5f, .5f), map->getNextEntityId());
+        model.addEntity(anchor, true);
+
+        map->for_each_chunk(
+          [&](Chunk& chunk) -> void
+          {
+            auto origin = game::math::chunkToEntityPos(chunk.getPos());
+            for (auto i = 0u; i < options.entitiesPerChunk; i++)
+            {
+              auto pos = origin + game::vec2<float>(unit(rng), unit(rng)) * static_cast<float>(game::math::chunkSize);
+              PhysicsEntity entity(pos, game::vec2<float>(.5f, .5f), game::vec2<float>(.5f, .5f), map->getNextEntityId());
+              entity.addForce(game::Force(game::vec2<float>(unit(rng) - .5f, unit(rng) - .5f) * 20.f, 1.f));
+              chunk.m_Data.m_Entities.push_back(entity);
+            }
+          }
+        );
+      },
+      [&](Model& model, uint32_t i) -> void
+      {
+        // keep things moving
+        if (i % 60 == 0)
+        {
+          model.getMap()->for_each_entity<PhysicsEntity>(
+            [&](auto& entity) -> void
+            {
+              entity.addForce(game::Force(game::vec2<float>(unit(rng) - .5f, unit(rng) - .5f) * 20.f, .5f));
+            }
+          );
+        }
+      }
+    );
+  }
+
+  Result churn(const Options& options, const std::filesystem::path& base)
+  {
+    std::shared_ptr<Entity> jumper;
+    const auto areaA = game::vec2<float>(8.f, 8.f);
+    const auto areaB = game::vec2<float>(8.f + 10 * game::math::chunkSize, 8.f);
+
+    return run("churn", options, base,
+      [&](Model& model) -> void
+      {
+        auto* map = model.getMap();
+        jumper = std::make_shared<Entity>(areaA, game::vec2<float>(1.f, 1.f), game::vec2<float>(.5f, .5f), map->getNextEntityId());
+        model.addEntity(jumper, true);
+
+        // give every chunk of both areas some content, so each reload moves real data
+        for (auto area : { areaA, areaB })
+        {
+          jumper->setPos(area);
+          tick(model);
+
+          map->for_each_chunk(
+            [&](Chunk& chunk) -> void
+            {
+              TileLayer tileData;
+              for (auto y = 0u; y < TileLayer::size; y++)
+              {
+                for (auto x = 0u; x < TileLayer::size; x++)
+                {
+                  tileData.set(x, y, Tile(1, 0.f));
+                }
+              }
+              chunk.m_Data.m_Tilesets.push_back(Tileset(0, 0.f, 0.f, 1.f, tileData));
+
+              auto origin = game::math::chunkToEntityPos(chunk.getPos());
+              for (auto i = 0u; i < options.entitiesPerChunk; i++)
+              {
+                auto pos = origin + game::vec2<float>(static_cast<float>(i % game::math::chunkSize), static_cast<float>(i / game::math::chunkSize % game::math::chunkSize));
+                chunk.m_Data.m_Entities.push_back(Entity(pos, game::vec2<float>(1.f, 1.f), game::vec2<float>(.5f, .5f), map->getNextEntityId()));
+              }
+            }
+          );
+        }
+      },
+      [&](Model&, uint32_t i) -> void
+      {
+        jumper->setPos(i % 2 == 0 ? areaA : areaB);
+      }
+    );
+  }
+
+  Result autosave(const Options& options, const std::filesystem::path& base)
+  {
+    std::shared_ptr<Entity> anchor;
+
+    return run("autosave", options, base,
+      [&](Model& model) -> void
+      {
+        auto* map = model.getMap();
+        anchor = std::make_shared<Entity>(game::vec2<float>(8.f, 8.f), game::vec2<float>(1.f, 1.f), game::vec2<float>(.5f, .5f), map->getNextEntityId());
+        model.addEntity(anchor, true);
+
+        map->for_each_chunk(
+          [&](Chunk& chunk) -> void
+          {
+            auto origin = game::math::chunkToEntityPos(chunk.getPos());
+            for (auto i = 0u; i < options.entitiesPerChunk; i++)
+            {
+              auto pos = origin + game::vec2<float>(static_cast<float>(i % game::math::chunkSize) + .5f, static_cast<float>(i / game::math::chunkSize % game::math::chunkSize) + .5f);
+              chunk.m_Data.m_Entities.push_back(Entity(pos, game::vec2<float>(1.f, 1.f), game::vec2<float>(.5f, .5f), map->getNextEntityId()));
+            }
+          }
+        );
+      },
+      [&](Model& model, uint32_t i) -> void
+      {
+        auto* map = model.getMap();
+
+        // back and forth, so it never leaves its chunk
+        auto step = game::vec2<float>((i / 60) % 2 == 0 ? .005f : -.005f, 0.f);
+        map->for_each_chunk(
+          [&](Chunk& chunk) -> void
+          {
+            if (!chunk.m_Data.m_Entities.empty())
+            {
+              game::getEntityPtr<Entity>(chunk.m_Data.m_Entities.front())->modXY(step);
+            }
+          }
+        );
+
+        if (i % 60 == 59)
+        {
+          map->autosave();
+        }
+      }
+    );
+  }
+
+  Result replaySession(const Options& options, const std::filesystem::path& base)
+  {
+    enterWorkDir(base, "replay");
+
+    if (!options.mapDir.empty())
+    {
+      std::filesystem::copy(options.mapDir, "data/map", std::filesystem::copy_options::recursive | std::filesystem::copy_options::overwrite_existing);
+    }
+
+    Result result { "replay", 0, 0., 0., 0, 0, 0, 0, 0, 0, 0 };
+
+    replay::Player player;
+    if (!player.open(options.replayFile))
+    {
+      fprintf(stderr, "can't replay %s\n", options.replayFile.c_str());
+      return result;
+    }
+
+    global::tickCount = 0;
+
+    auto* model = new Model();
+    if (!mapUsable(*model))
+    {
+      delete model;
+      return result;
+    }
+    auto* map = model->getMap();
+    if (options.codec)
+    {
+      map->setChunkCodec(*options.codec);
+    }
+
+    replay::Input input;
+    replay::Frame frame;
+    // stand-ins for the render cameras, tracked like them
+    std::vector<std::shared_ptr<Entity>> cameras;
+    std::vector<double> tickMs;
+
+    auto before = Counters::now();
+    auto start = Clock::now();
+
+    while (player.next(frame))
+    {
+      for (auto pos : frame.clicks)
+      {
+        input.click(*map, pos);
+      }
+      input.moveSelected(*map, frame.keys);
+
+      while (cameras.size() < frame.cameras.size())
+      {
+        cameras.push_back(std::make_shared<Entity>());
+        model->addEntity(cameras.back(), true);
+      }
+      for (auto i = 0u; i < frame.cameras.size(); i++)
+      {
+        cameras[i]->setPos(frame.cameras[i]);
+      }
+
+      global::lastTickDuration = frame.tickDuration;
+
+      auto tickStart = Clock::now();
+      tick(*model);
+      tickMs.push_back(secondsSince(tickStart) * 1000.);
+    }
+
+    result.ticks = tickMs.size();
+    result.tickSeconds = secondsSince(start);
+
+    start = Clock::now();
+    delete model;
+    result.shutdownSeconds = secondsSince(start);
+
+    auto after = Counters::now();
+    result.chunkLoads   = after.loads - before.loads;
+    result.chunksGenerated = after.generated - before.generated;
+    result.generatedCached = after.generatedCached - before.generatedCached;
+    result.chunkSaves   = after.saves - before.saves;
+    result.deltaSaves   = after.deltaSaves - before.deltaSaves;
+    result.bytesWritten = after.bytesWritten - before.bytesWritten;
+    result.bytesRead    = after.bytesRead - before.bytesRead;
+
+    if (!options.tickCsv.empty())
+    {
+      std::ofstream csv(options.tickCsv);
+      csv << "tick,ms\n";
+      for (auto i = 0u; i < tickMs.size(); i++)
+      {
+        csv << i << ',' << tickMs[i] << '\n';
+      }
+    }
+
+    if (!tickMs.empty())
+    {
+      auto sorted = tickMs;
+      std::sort(sorted.begin(), sorted.end());
+      auto percentile = [&](double p) -> double
+      {
+        return sorted[static_cast<size_t>(p * (sorted.size() - 1))];
+      };
+      printf("replay tick ms: p50 %.3f  p99 %.3f  max %.3f\n", percentile(.5), percentile(.99), sorted.back());
+    }
+
+    return result;
+  }
+
+  // serialized chunk data, either from an existing map or made up like an edited map
+  std::vector<std::vector<uint8_t>> sampleChunks(const Options& options)
+  {
+    std::vector<std::vector<uint8_t>> chunks;
+
+    if (!options.mapDir.empty())
+    {
+      for (const auto& entry : std::filesystem::directory_iterator(std::filesystem::path(options.mapDir) / "chunks"))
+      {
+        std::vector<uint8_t> data;
+        if (entry.path().extension() == ".tdat" && filesystem::readFile(entry.path().string(), data) && compression::unpack(data))
+        {
+          chunks.push_back(std::move(data));
+        }
+      }
+      return chunks;
+    }
+
+    std::mt19937 rng(99);
+    for (auto i = 0; i < 256; i++)
+    {
+      Chunk::Data data { };
+
+      // a few painted tiles per layer, like the editor leaves them
+      auto layers = 1 + rng() % 3;
+      for (auto layer = 0u; layer < layers; layer++)
+      {
+        TileLayer tileData;
+        for (auto painted = rng() % 40; painted > 0; painted--)
+        {
+          tileData.set(rng() % TileLayer::size, rng() % TileLayer::size, Tile(static_cast<char>(1 + rng() % 200), 90.f * (rng() % 4)));
+        }
+        data.m_Tilesets.push_back(Tileset(layer, 0.f, 0.f, 1.f, tileData));
+      }
+
+      for (auto e = 0u; e < options.entitiesPerChunk; e++)
+      {
+        auto pos = game::vec2<float>(static_cast<float>(rng() % 1000) / 10.f, static_cast<float>(rng() % 1000) / 10.f);
+        data.m_Entities.push_back(Entity(pos, game::vec2<float>(1.f, 1.f), game::vec2<float>(.5f, .5f), i * options.entitiesPerChunk + e));
+      }
+
+      filesystem::BufferWriter ar;
+      ar(data);
+      chunks.push_back(ar.buffer());
+    }
+    return chunks;
+  }
+
+  void generation()
+  {
+    Generator generator(1234, 0, 1);
+
+    printf("%-10s %8s %14s %14s\n", "threads", "chunks", "chunks/s", "rock cells %");
+
+    auto cores = std::max(1u, std::thread::hardware_concurrency());
+    for (auto threadCount : { 1u, cores })
+    {
+      // a square of chunks per round, each round further away so nothing repeats
+      constexpr int side = 32;
+      std::atomic<uint64_t> rockCells { 0 };
+      uint64_t chunks = 0;
+      auto rounds = 0;
+      auto start = Clock::now();
+
+      do
+      {
+        std::atomic<int> next { 0 };
+        std::vector<std::thread> workers;
+        for (auto i = 0u; i < threadCount; i++)
+        {
+          workers.emplace_back(
+            [&]() -> void
+            {
+              Chunk::Data data;
+              for (auto index = next++; index < side * side; index = next++)
+              {
+                generator.generate(game::vec2<int>(index % side + rounds * side, index / side), data);
+                rockCells += data.m_GameLayer.mask(Generator::rockId).count();
+              }
+            }
+          );
+        }
+        for (auto& worker : workers)
+        {
+          worker.join();
+        }
+        chunks += side * side;
+        rounds++;
+      } while (secondsSince(start) < .5);
+
+      printf("%-10u %8lu %14.1f %14.1f\n",
+        threadCount,
+        static_cast<unsigned long>(chunks),
+        chunks / secondsSince(start),
+        100. * rockCells / (chunks * game::math::chunkSize * game::math::chunkSize)
+      );
+
+      if (cores == 1)
+      {
+        break;
+      }
+    }
+  }
+
+  // returns whether the batch functions match the scalar ones for every sample
+  bool noiseSamples()
+  {
+    // one chunk worth of coordinates, as the generator asks for them
+    constexpr size_t side = game::math::chunkSize;
+    constexpr size_t octaves = 6;
+    std::mt19937 rng(99);
+    std::uniform_real_distribution<float> coordinate(-4096.f, 4096.f);
+
+    std::vector<float> xs(side * side), ys(side * side), batch(side * side);
+    for (auto i = 0u; i < xs.size(); i++)
+    {
+      xs[i] = coordinate(rng);
+      ys[i] = coordinate(rng);
+    }
+    SimplexNoise fbm(99u, 1.f / 48.f);
+
+    uint64_t mismatches = 0;
+    fbm.noise(xs.data(), ys.data(), batch.data(), xs.size());
+    for (auto i = 0u; i < xs.size(); i++)
+    {
+      mismatches += fbm.noise(xs[i], ys[i]) != batch[i];
+    }
+    fbm.fractal(octaves, xs.data(), side, ys.data(), side, batch.data());
+    for (auto i = 0u; i < batch.size(); i++)
+    {
+      mismatches += fbm.fractal(octaves, xs[i % side], ys[i / side]) != batch[i];
+    }
+
+    // volatile sink, or the scalar loops could be dropped
+    volatile float sink = 0.f;
+
+    auto measure = [&](auto&& lam) -> double
+    {
+      uint64_t samples = 0;
+      auto start = Clock::now();
+      do
+      {
+        samples += lam();
+      } while (secondsSince(start) < .3);
+      return samples / secondsSince(start);
+    };
+
+    auto scalarNoise = measure([&]() -> uint64_t
+    {
+      for (auto i = 0u; i < xs.size(); i++)
+      {
+        sink = sink + fbm.noise(xs[i], ys[i]);
+      }
+      return xs.size();
+    });
+    auto batchNoise = measure([&]() -> uint64_t
+    {
+      fbm.noise(xs.data(), ys.data(), batch.data(), xs.size());
+      sink = sink + batch[0];
+      return xs.size();
+    });
+    auto scalarFractal = measure([&]() -> uint64_t
+    {
+      for (auto i = 0u; i < batch.size(); i++)
+      {
+        sink = sink + fbm.fractal(octaves, xs[i % side], ys[i / side]);
+      }
+      return batch.size() * octaves;
+    });
+    auto batchFractal = measure([&]() -> uint64_t
+    {
+      fbm.fractal(octaves, xs.data(), side, ys.data(), side, batch.data());
+      sink = sink + batch[0];
+      return batch.size() * octaves;
+    });
+
+    printf("%-10s %16s %16s %8s\n", "function", "scalar samples/s", "batch samples/s", "speedup");
+    printf("%-10s %16.3g %16.3g %8.2f\n", "noise", scalarNoise, batchNoise, batchNoise / scalarNoise);
+    printf("%-10s %16.3g %16.3g %8.2f\n", "fractal", scalarFractal, batchFractal, batchFractal / scalarFractal);
+    printf("results differing from the scalar functions: %lu\n", static_cast<unsigned long>(mismatches));
+    return mismatches == 0;
+  }
+
+  // returns whether both lookups agree everywhere
+  bool tilemapLookups()
+  {
+    // every index with every rotation, a tileset full of them at a time
+    constexpr unsigned combinations = 255 * 4;
+    constexpr unsigned perTileset = TileLayer::size * TileLayer::size;
+    // sample points per tile and side, off the tile borders where both lookups may round to either neighbour
+    constexpr unsigned steps = 8;
+
+    uint64_t tiles = 0;
+    uint64_t samples = 0;
+    uint64_t mismatches = 0;
+    float maxError = 0.f;
+
+    for (auto first = 0u; first < combinations; first += perTileset)
+    {
+      TileLayer tileData;
+      for (auto cell = 0u; cell < perTileset && first + cell < combinations; cell++)
+      {
+        auto combination = first + cell;
+        tileData.set(cell % TileLayer::size, cell / TileLayer::size, Tile(static_cast<char>(1 + combination / 4), 90.f * (combination % 4)));
+      }
+      Tileset ts(0, 0.f, 0.f, 1.f, tileData);
+
+      tilemap::IndexMap map;
+      tilemap::encode(ts, map);
+
+      for (auto cell = 0u; cell < perTileset; cell++)
+      {
+        tiles += first + cell < combinations;
+        for (auto k = 0u; k < steps * steps; k++)
+        {
+          auto uv = game::vec2<float>(
+            (cell % TileLayer::size + (k % steps + .5f) / steps) / TileLayer::size,
+            (cell / TileLayer::size + (k / steps + .5f) / steps) / TileLayer::size
+          );
+          auto expected = tilemap::perTileAtlasCoord(ts, uv);
+          auto actual = tilemap::atlasCoord(map, uv);
+          samples++;
+
+          if (expected.has_value() != actual.has_value())
+          {
+            mismatches++;
+            continue;
+          }
+          if (expected)
+          {
+            // compared in atlas texels of a 16 px tile, anything below one texel samples the same
+            float error = std::max(std::abs((*expected)[0] - (*actual)[0]), std::abs((*expected)[1] - (*actual)[1])) * tilemap::atlasCells * 16.f;
+            maxError = std::max(maxError, error);
+            mismatches += error >= .5f;
+          }
+        }
+      }
+    }
+
+    printf("%-10s %8s %10s %12s\n", "tiles", "samples", "mismatches", "max error px");
+    printf("%-10lu %8lu %10lu %12.5f\n",
+      static_cast<unsigned long>(tiles),
+      static_cast<unsigned long>(samples),
+      static_cast<unsigned long>(mismatches),
+      maxError
+    );
+    return mismatches == 0;
+  }
+
+  // returns whether the bit-plane queries agree with reading the game layer cell by cell
+  bool gamelayerQueries(const std::filesystem::path& base)
+  {
+    enterWorkDir(base, "gamelayer");
+
+    auto* model = new Model();
+    if (!mapUsable(*model))
+    {
+      delete model;
+      return false;
+    }
+    auto* map = model->getMap();
+    // held here, the map drops tracked entities nobody else references
+    auto anchor = std::make_shared<Entity>(game::vec2<float>(.5f, .5f), game::vec2<float>(1.f, 1.f), game::vec2<float>(.5f, .5f), map->getNextEntityId());
+    model->addEntity(anchor, true);
+    tick(*model);
+
+    constexpr int size = game::math::chunkSize;
+    // 0 and a few common ids, one using the high planes (negative as char), one that never occurs
+    const std::array<char, 6> ids { 0, 1, 2, 3, static_cast<char>(0xc5), 42 };
+    std::mt19937 rng(4321);
+
+    // some chunks empty, some dense, so line scans cross chunks without finding anything
+    map->for_each_chunk(
+      [&](Chunk& chunk) -> void
+      {
+        auto density = rng() % 4;
+        for (auto y = 0u; y < size; y++)
+        {
+          for (auto x = 0u; x < size; x++)
+          {
+            chunk.m_Data.m_GameLayer.set(x, y, rng() % 8 < density ? ids[1 + rng() % 4] : 0);
+          }
+        }
+        chunk.touch();
+      }
+    );
+
+    uint64_t maskChecks = 0, maskMismatches = 0;
+    uint64_t boxChecks = 0, boxMismatches = 0;
+    uint64_t lineChecks = 0, lineMismatches = 0;
+
+    // one chunk: mask, row, column, count and intersects against get()
+    map->for_each_chunk(
+      [&](Chunk& chunk) -> void
+      {
+        const auto& layer = chunk.m_Data.m_GameLayer;
+        for (auto id : ids)
+        {
+          auto mask = layer.mask(id);
+          size_t count = 0;
+          for (auto y = 0u; y < size; y++)
+          {
+            for (auto x = 0u; x < size; x++)
+            {
+              bool expected = layer.get(x, y) == id;
+              count += expected;
+              maskChecks += 3;
+              maskMismatches += mask.test(x, y) != expected;
+              maskMismatches += ((mask.row(y) >> x) & 1u) != expected;
+              maskMismatches += ((mask.column(x) >> y) & 1u) != expected;
+            }
+          }
+          maskChecks++;
+          maskMismatches += mask.count() != count;
+
+          // rectangles partly or completely outside the chunk get clipped
+          for (auto i = 0; i < 64; i++)
+          {
+            int x = static_cast<int>(rng() % (2 * size)) - size / 2;
+            int y = static_cast<int>(rng() % (2 * size)) - size / 2;
+            int w = static_cast<int>(rng() % (size + 4));
+            int h = static_cast<int>(rng() % (size + 4));
+
+            bool expected = false;
+            for (auto cy = std::max(y, 0); cy < std::min(y + h, size); cy++)
+            {
+              for (auto cx = std::max(x, 0); cx < std::min(x + w, size); cx++)
+              {
+                expected |= layer.get(cx, cy) == id;
+              }
+            }
+            maskChecks++;
+            maskMismatches += mask.intersects(Chunk::cellMask::rect(x, y, w, h)) != expected;
+          }
+        }
+      }
+    );
+
+    // the map queries over the loaded chunks around the origin and past them, negative cells included.
+    // id 0 is left out, unloaded chunks have no cells while getGamelayerIdAt reads them as 0
+    auto idAt = [&](int x, int y) -> char
+    {
+      return map->getGamelayerIdAt(game::vec2<float>(x + .5f, y + .5f));
+    };
+    std::uniform_int_distribution<int> cell(-3 * size, 3 * size);
+    std::uniform_real_distribution<float> coordinate(-3.f * size, 3.f * size);
+    std::uniform_real_distribution<float> extent(0.f, 1.5f * size);
+
+    for (auto i = 0; i < 20000; i++)
+    {
+      auto id = ids[1 + rng() % (ids.size() - 1)];
+
+      auto topLeft = game::vec2<float>(coordinate(rng), coordinate(rng));
+      auto boxSize = game::vec2<float>(extent(rng), extent(rng));
+      bool expected = false;
+      for (auto y = static_cast<int>(floor(topLeft[1])); y <= static_cast<int>(floor(topLeft[1] + boxSize[1])); y++)
+      {
+        for (auto x = static_cast<int>(floor(topLeft[0])); x <= static_cast<int>(floor(topLeft[0] + boxSize[0])); x++)
+        {
+          expected |= idAt(x, y) == id;
+        }
+      }
+      boxChecks++;
+      boxMismatches += map->anyGamelayerInBox(id, topLeft, boxSize) != expected;
+
+      // both directions, from and to included
+      auto line = cell(rng);
+      auto from = cell(rng);
+      auto to = cell(rng);
+      auto step = from <= to ? 1 : -1;
+      std::optional<int> inRow, inColumn;
+      for (auto c = from; ; c += step)
+      {
+        if (!inRow && idAt(c, line) == id)
+        {
+          inRow = c;
+        }
+        if (!inColumn && idAt(line, c) == id)
+        {
+          inColumn = c;
+        }
+        if (c == to)
+        {
+          break;
+        }
+      }
+      lineChecks += 2;
+      lineMismatches += map->firstGamelayerInRow(id, line, from, to) != inRow;
+      lineMismatches += map->firstGamelayerInColumn(id, line, from, to) != inColumn;
+    }
+
+    delete model;
+
+    printf("%-10s %10s %10s\n", "query", "checks", "mismatches");
+    printf("%-10s %10lu %10lu\n", "mask", static_cast<unsigned long>(maskChecks), static_cast<unsigned long>(maskMismatches));
+    printf("%-10s %10lu %10lu\n", "box", static_cast<unsigned long>(boxChecks), static_cast<unsigned long>(boxMismatches));
+    printf("%-10s %10lu %10lu\n", "line", static_cast<unsigned long>(lineChecks), static_cast<unsigned long>(lineMismatches));
+    return maskMismatches + boxMismatches + lineMismatches == 0;
+  }
+
+  void codecs(const Options& options)
+  {
+    auto chunks = sampleChunks(options);
+    if (chunks.empty())
+    {
+      fprintf(stderr, "no chunks to compress\n");
+      return;
+    }
+
+    printf("%-10s %8s %14s %14s %8s %14s %14s\n", "codec", "chunks", "raw bytes", "disk bytes", "ratio", "compress MB/s", "decomp MB/s");
+
+    for (auto codec : { compression::Codec::None, compression::Codec::LZ4 })
+    {
+      uint64_t rawBytes = 0;
+      uint64_t diskBytes = 0;
+      double packSeconds = 0.;
+      double unpackSeconds = 0.;
+
+      // repeat until the timings are long enough to mean something
+      auto rounds = 0u;
+      do
+      {
+        rawBytes = 0;
+        diskBytes = 0;
+        for (const auto& chunk : chunks)
+        {
+          std::vector<uint8_t> packed;
+          auto start = Clock::now();
+          compression::pack(codec, chunk, packed);
+          packSeconds += secondsSince(start);
+
+          diskBytes += packed.size();
+          rawBytes += chunk.size();
+
+          start = Clock::now();
+          compression::unpack(packed);
+          unpackSeconds += secondsSince(start);
+        }
+        rounds++;
+      } while (packSeconds + unpackSeconds < .2 && rounds < 10000);
+
+      double megabytes = static_cast<double>(rawBytes) * rounds / (1024. * 1024.);
+      printf("%-10s %8zu %14lu %14lu %8.2f %14.1f %14.1f\n",
+        compression::codecName(codec),
+        chunks.size(),
+        static_cast<unsigned long>(rawBytes),
+        static_cast<unsigned long>(diskBytes),
+        static_cast<double>(rawBytes) / diskBytes,
+        megabytes / packSeconds,
+        megabytes / unpackSeconds
+      );
+    }
+  }
+
+  void print(const Result& result)
+  {
+    printf("%-10s %8u %12.1f %14.1f %10lu %10lu %10lu %10lu %10lu %14lu %12.2f %12.1f\n",
+      result.name.c_str(),
+      result.ticks,
+      result.ticks / result.tickSeconds,
+      (result.chunkLoads + result.chunksGenerated) / result.tickSeconds,
+      static_cast<unsigned long>(result.chunkLoads),
+      static_cast<unsigned long>(result.chunksGenerated),
+      static_cast<unsigned long>(result.generatedCached),
+      static_cast<unsigned long>(result.chunkSaves),
+      static_cast<unsigned long>(result.deltaSaves),
+      static_cast<unsigned long>(result.bytesWritten),
+      result.bytesWritten / result.tickSeconds / (1024. * 1024.),
+      result.shutdownSeconds * 1000.
+    );
+  }
+}
+
+int main(int argc, char** argv)
+{
+  Options options;
+  options.workDir = (std::filesystem::temp_directory_path() / "blub_bench").string();
+
+  int c;
+  while ((c = getopt(argc, argv, "s:t:n:m:d:p:r:i:c:z:")) != -1)
+  {
+    switch (c)
+    {
+      case 's':
+        options.scenario = optarg;
+        break;
+      case 't':
+        options.ticks = atoi(optarg);
+        break;
+      case 'n':
+        options.entities = atoi(optarg);
+        break;
+      case 'm':
+        options.entitiesPerChunk = atoi(optarg);
+        break;
+      case 'd':
+        options.workDir = optarg;
+        break;
+      case 'p':
+        options.traceFile = optarg;
+        break;
+      case 'r':
+        options.replayFile = optarg;
+        options.scenario = "replay";
+        break;
+      case 'i':
+        options.mapDir = optarg;
+        break;
+      case 'c':
+        options.tickCsv = optarg;
+        break;
+      case 'z':
+        if (std::string(optarg) == "none")     options.codec = compression::Codec::None;
+        else if (std::string(optarg) == "lz4") options.codec = compression::Codec::LZ4;
+        else
+        {
+          fprintf(stderr, "unknown codec \"%s\"\n", optarg);
+          return EXIT_FAILURE;
+        }
+        break;
+      default:
+        fprintf(stderr, "usage: %s [-s all|tracked|physics|churn|autosave] [-t ticks] [-n entities] [-m entities per chunk] [-z none|lz4] [-d workdir] [-p trace.json]\n"
+                        "       %s -r session.rpl [-i mapdir] [-c ticks.csv] [-z none|lz4] [-d workdir] [-p trace.json]\n"
+                        "       %s -s codec [-i mapdir] [-m entities per chunk]\n"
+                        "       %s -s generate|noise|tilemap|gamelayer\n", argv[0], argv[0], argv[0], argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+
+  auto startDir = std::filesystem::current_path();
+  auto base = std::filesystem::absolute(options.workDir);
+
+  // relative paths given on the command line must survive the chdir into the work directory
+  if (!options.replayFile.empty())
+  {
+    options.replayFile = std::filesystem::absolute(options.replayFile).string();
+  }
+  if (!options.mapDir.empty())
+  {
+    options.mapDir = std::filesystem::absolute(options.mapDir).string();
+  }
+  if (!options.tickCsv.empty())
+  {
+    options.tickCsv = std::filesystem::absolute(options.tickCsv).string();
+  }
+
+  if (!options.traceFile.empty())
+  {
+    profiler::setEnabled(true);
+  }
+
+  bool any = false;
+  // self-checking scenarios clear it on a mismatch, the exit code tells a script
+  bool passed = true;
+  if (options.scenario == "codec")
+  {
+    codecs(options);
+    any = true;
+  }
+  else if (options.scenario == "generate")
+  {
+    generation();
+    any = true;
+  }
+  else if (options.scenario == "noise")
+  {
+    passed = noiseSamples();
+    any = true;
+  }
+  else if (options.scenario == "tilemap")
+  {
+    passed = tilemapLookups();
+    any = true;
+  }
+  else if (options.scenario == "gamelayer")
+  {
+    passed = gamelayerQueries(base);
+    any = true;
+  }
+  else
+  {
+    printf("%-10s %8s %12s %14s %10s %10s %10s %10s %10s %14s %12s %12s\n",
+      "scenario", "ticks", "ticks/s", "chunks in/s", "loads", "generated", "gen cached", "saves", "deltas", "bytes written", "MB/s written", "shutdown ms");
+
+    if (options.scenario == "all" || options.scenario == "tracked") { print(tracked(options, base)); any = true; }
+    if (options.scenario == "all" || options.scenario == "physics") { print(physics(options, base)); any = true; }
+    if (options.scenario == "all" || options.scenario == "churn")   { print(churn(options, base));   any = true; }
+    if (options.scenario == "all" || options.scenario == "autosave") { print(autosave(options, base)); any = true; }
+    if (options.scenario == "replay")                               { print(replaySession(options, base)); any = true; }
+  }
+
+  std::filesystem::current_path(startDir);
+
+  if (!any)
+  {
+    fprintf(stderr, "unknown scenario \"%s\"\n", options.scenario.c_str());
+    return EXIT_FAILURE;
+  }
+
+  if (!options.traceFile.empty())
+  {
+    profiler::printSummary();
+    profiler::writeChromeTrace(options.traceFile);
+  }
+
+  if (!passed)
+  {
+    fprintf(stderr, "scenario \"%s\" found mismatches\n", options.scenario.c_str());
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
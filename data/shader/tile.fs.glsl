@@ -15,12 +15,17 @@ uniform int numLights;
 
 uniform sampler2D nmap;
 
+// tilemap mode: tex is a tile index map (r = index, g = quarter turns), tiles are read from atlas
+uniform int tilemapMode;
+uniform vec2 tilemapSize;
+uniform sampler2D atlas;
+
 float rand(float seed) {
   return fract(sin(seed)*584216.0);
 }
 
-float normalFac(int lightIndex) {
-  vec3 normalVec = normalize(texture2D(nmap, texCoord).xyz * 2.0 - 1.0);
+float normalFac(int lightIndex, vec2 atlasCoord) {
+  vec3 normalVec = normalize(texture2D(nmap, atlasCoord).xyz * 2.0 - 1.0);
 
   vec3 lightVec = normalize(vec3(gl_FragCoord.xy - lights[lightIndex].xy*pixelsInUnit, -1.0));
 
@@ -31,13 +36,13 @@ float normalFac(int lightIndex) {
   return ( (dot(normalVec, lightVec)*0.5) + 0.5 ) * (1.0-near) + near;
 }
 
-vec3 lightFac() {
+vec3 lightFac(vec2 atlasCoord) {
   float fac = 0.0;
   vec3 avgColor = vec3(0.0, 0.0, 0.0);
   for(int i=0; i<numLights; i++) {
     vec3 lightUnits = lights[i]*pixelsInUnit;
     float dist = distance(gl_FragCoord.xy, lightUnits.xy);
-    float newfac = (1.0-smoothstep(0.0,lightUnits.z+0.036*sin(5.0*ftime)*pixelsInUnit,dist)) * normalFac(i);
+    float newfac = (1.0-smoothstep(0.0,lightUnits.z+0.036*sin(5.0*ftime)*pixelsInUnit,dist)) * normalFac(i, atlasCoord);
     fac = max(fac, newfac);
     avgColor += lightColors[i] * newfac;
   }
@@ -45,9 +50,44 @@ vec3 lightFac() {
   return fac*avgColor + (1.0-fac)*ambient;
 }
 
+// keep in sync with tilemap::atlasCoord (src/logic/tilemap.cpp)
+bool tilemapCoord(out vec2 atlasCoord) {
+  vec2 cellPos = texCoord * tilemapSize;
+  ivec2 cell = ivec2(clamp(floor(cellPos), vec2(0.0), tilemapSize - 1.0));
+  vec4 texel = texelFetch(tex, cell, 0);
+
+  int index = int(texel.r * 255.0 + 0.5);
+  if(index == 0) {
+    return false;
+  }
+
+  vec2 local = cellPos - vec2(cell);
+
+  // quarter turns clockwise
+  int turns = int(texel.g * 255.0 + 0.5);
+  if(turns == 1) {
+    local = vec2(local.y, 1.0 - local.x);
+  } else if(turns == 2) {
+    local = vec2(1.0) - local;
+  } else if(turns == 3) {
+    local = vec2(1.0 - local.y, local.x);
+  }
+
+  atlasCoord = (vec2(float(index % 16), float(index / 16)) + local) / 16.0;
+  return true;
+}
+
 void main(void)
 {
-  fragColor = texture2D(tex, texCoord) * vec4(lightFac(), 1.0);
+  if(tilemapMode == 1) {
+    vec2 atlasCoord;
+    if(!tilemapCoord(atlasCoord)) {
+      discard;
+    }
+    fragColor = texture2D(atlas, atlasCoord) * vec4(lightFac(atlasCoord), 1.0);
+  } else {
+    fragColor = texture2D(tex, texCoord) * vec4(lightFac(texCoord), 1.0);
+  }
 }
 
 /*
@@ -20,6 +20,7 @@
 #include "logic/model.h"
 #include "renderer/renderer.h"
 #include "editor/editor.h"
+#include "game/replay.h"
 
 class Controller
 {
@@ -28,6 +29,16 @@ class Controller
     void handleSDLEvents();
     
     bool m_Quit;
+    // toggled with M
+    bool m_ShowMinimap = false;
+    
+    // chrome trace is written here on quit, empty if profiling is off
+    std::string m_ProfileOutput;
+    
+    replay::Input m_Input;
+    replay::Recorder m_Recorder;
+    // input of the current tick, only filled while recording
+    replay::Frame m_Frame;
     
     SDL_MouseMotionEvent m_MouseMotion;
     SDL_MouseButtonEvent m_MouseButton;
@@ -39,8 +50,12 @@ class Controller
     
     static constexpr float m_IdealCameraScale = 14;
     
+    // about every 30s at 60fps, most of them only append moved entities to the chunk logs
+    static constexpr uint32_t m_AutosaveTicks = 1800;
+    
   public:
-    void init(int argc, char** argv);
+    // false if the game can't start, the reason is printed
+    bool init(int argc, char** argv);
       
     Model* m_Model;
     Renderer* m_Renderer;
@@ -25,7 +25,8 @@ class Editor
   game::vec2<float> mapTileSelectionStartPos { 0.f, 0.f };
   
   
-  std::vector<std::vector<Tile>> selectedTiles;
+  // selection from the tileset image, a tileset image is no bigger than a chunk
+  TileLayer selectedTiles;
   
   game::vec2<int> tileSelectionPos { -1, -1 };
   game::vec2<int> tileSelectionSize { 0, 0 };
@@ -0,0 +1,41 @@
+/*
+ *  FILENAME:      checksum.h
+ *
+ *  DESCRIPTION:
+ *      CRC-32 framing of files written through filesystem::, so torn or damaged files are detected on load
+ *
+ *  PUBLIC FUNCTIONS:
+ *      uint32_t    crc32(const uint8_t* data, size_t size)
+ *      void        seal(std::vector<uint8_t>& data)
+ *      bool        unseal(std::vector<uint8_t>& data)
+ *      bool        isSealed(const std::vector<uint8_t>& data)
+ *
+ *  NOTES:
+ *      Sealed data starts with "BSUM" and the CRC-32 (zlib polynomial) of everything after that header.
+ *      It wraps whatever compression::pack produced. Data without the header was written before checksums existed and passes unchecked.
+ *
+ */
+
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace checksum
+{
+  static constexpr size_t headerSize = 8;
+
+  uint32_t crc32(const uint8_t* data, size_t size);
+
+  // puts the header in front of data
+  void seal(std::vector<uint8_t>& data);
+
+  // removes the header, false if the data doesn't match its checksum. Unsealed data is left alone
+  bool unseal(std::vector<uint8_t>& data);
+
+  bool isSealed(const std::vector<uint8_t>& data);
+}
+
+#endif /* CHECKSUM_H */
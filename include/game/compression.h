@@ -0,0 +1,51 @@
+/*
+ *  FILENAME:      compression.h
+ *
+ *  DESCRIPTION:
+ *      Block compression for files written through filesystem::
+ *
+ *  PUBLIC FUNCTIONS:
+ *      void        pack(Codec codec, const std::vector<uint8_t>& raw, std::vector<uint8_t>& out)
+ *      bool        unpack(std::vector<uint8_t>& data)
+ *      void        compressLZ4(const uint8_t* src, size_t size, std::vector<uint8_t>& out)
+ *      bool        decompressLZ4(const uint8_t* src, size_t size, uint8_t* dst, size_t dstSize)
+ *
+ *  NOTES:
+ *      LZ4 is implemented here in its block format (greedy, single hash table), blocks stay readable by the reference liblz4.
+ *      Packed data starts with "BLZ", the codec and the uncompressed size (uint32), for Codec::None as well.
+ *      Data without that header is taken as raw, so files written before compression existed load unchanged.
+ *
+ */
+
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace compression
+{
+  enum class Codec : uint8_t
+  {
+    None = 0,
+    LZ4  = 1
+  };
+
+  static constexpr size_t headerSize = 8;
+
+  const char* codecName(Codec codec);
+
+  // Codec::None copies raw as is behind the header
+  void pack(Codec codec, const std::vector<uint8_t>& raw, std::vector<uint8_t>& out);
+
+  // replaces packed data by its raw bytes, data without header (legacy files) is left alone. False if the data is packed but broken
+  bool unpack(std::vector<uint8_t>& data);
+
+  void compressLZ4(const uint8_t* src, size_t size, std::vector<uint8_t>& out);
+
+  // dstSize has to be the exact uncompressed size
+  bool decompressLZ4(const uint8_t* src, size_t size, uint8_t* dst, size_t dstSize);
+}
+
+#endif /* COMPRESSION_H */
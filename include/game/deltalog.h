@@ -0,0 +1,39 @@
+/*
+ *  FILENAME:      deltalog.h
+ *
+ *  DESCRIPTION:
+ *      Append-only log of changes on top of a saved file, e.g. the entities that changed since a chunk's last full save
+ *
+ *  PUBLIC FUNCTIONS:
+ *      bool        append(const std::string& path, uint32_t base, const std::vector<uint8_t>& payload)
+ *      size_t      read(const std::string& path, uint32_t base, std::vector<std::vector<uint8_t>>& payloads)
+ *      void        clear(const std::string& path)
+ *
+ *  NOTES:
+ *      A record is its payload size, the base it was written against and the CRC-32 of the payload (uint32 each), then the payload.
+ *      base names the full save a record belongs to: records left over from an older one are skipped, never applied on top of a newer one.
+ *      A record torn by a crash ends the log, the records before it still count.
+ *
+ */
+
+#ifndef DELTALOG_H
+#define DELTALOG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace deltalog
+{
+  static constexpr size_t recordHeaderSize = 12;
+
+  bool append(const std::string& path, uint32_t base, const std::vector<uint8_t>& payload);
+
+  // payloads of the intact records written against base in the order they were appended, returns their size on disk
+  size_t read(const std::string& path, uint32_t base, std::vector<std::vector<uint8_t>>& payloads);
+
+  void clear(const std::string& path);
+}
+
+#endif /* DELTALOG_H */
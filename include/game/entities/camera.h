@@ -27,6 +27,7 @@
 #include "game/entity.h"
 #include "logic/map.h"
 #include "renderer/overlay.h"
+#include "renderer/sprite.h"
 
 class Camera: public Entity
 {
@@ -38,8 +39,18 @@ class Camera: public Entity
         std::list<const Overlay*> overlays;
 
         GPU_Rect getTile(GPU_Image* img, unsigned char index, unsigned char inset);
+        static bool visibleRange(float first, float step, float extent, float view, unsigned count, unsigned& from, unsigned& to);
 
   public:
+        //counted over all cameras since the start, compare them between frames
+        struct Stats
+        {
+          uint64_t blits = 0;
+          uint64_t tilesVisited = 0;
+          uint64_t tilesetsSkipped = 0;
+        };
+        static Stats stats;
+
         Camera(): Camera(0,0,0,0,16){}
         Camera(float x, float y, float w, float h, float scale);
         ~Camera();
@@ -63,7 +74,8 @@ class Camera: public Entity
 
         void clearRender();
         void renderTileset(const Tileset& ts, GPU_Image* img, float factor_width, float factor_height, float x_offset, float y_offset);
-        void render2dMap(int* data, SDL_Color (*conversion)(int), size_t w, size_t h);
+        void renderTilemap(const Tileset& ts, GPU_Image* indexMap, float x_offset, float y_offset);
+        void renderImage(GPU_Image* img, float x_offset, float y_offset, float w, float h);
         void renderEntity(Entity& e);
         void renderOverlays();
 
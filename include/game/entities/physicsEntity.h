@@ -23,20 +23,11 @@ class PhysicsEntity : public Entity
     
     void addForce(game::Force force);
     
-    void write(std::ofstream& out) override
+    template<typename Archive>
+    void serialize(Archive& ar)
     {
-      Entity::write(out);
-      filesystem::writeStruct(out, m_Mass);
-      filesystem::writeStruct(out, m_Velocity);
-      filesystem::writeRange(out, m_Forces);
-    }
-    
-    void read(std::ifstream& in) override
-    {
-      Entity::read(in);
-      filesystem::readStruct(in, m_Mass);
-      filesystem::readStruct(in, m_Velocity);
-      filesystem::readRange(in, m_Forces);
+      Entity::serialize(ar);
+      ar(m_Mass, m_Velocity, m_Forces);
     }
 };
 
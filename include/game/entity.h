@@ -19,16 +19,22 @@
 #endif
 
 #include <cmath>
+#include <memory>
 
 #include "game/vector.hpp"
 #include "game/filesystem.hpp"
-#include "game/saveable.h"
-#include "renderer/sprite.h"
-#include "renderer/simplesprite.h"
+
+// sprites are only drawn by the renderer, logic just passes them along (keeps game/ and logic/ free of SDL_gpu)
+class Sprite;
+
+namespace game
+{
+  using SharedSpritePtr = std::shared_ptr<Sprite>;
+}
 
 using game::vec2;
 
-class Entity : public Saveable {
+class Entity {
 
   private:
 
@@ -58,20 +64,11 @@ class Entity : public Saveable {
     unsigned int getId() const;
     void modXY(const vec2<float>& xy);
 
-    void write(std::ofstream& out) override
-    {
-      filesystem::writeStruct(out, id);
-      filesystem::writeStruct(out, pos);
-      filesystem::writeStruct(out, size);
-      filesystem::writeStruct(out, anchor);
-    }
-    
-    void read(std::ifstream& in) override
+    // not virtual, entities are saved through game::EntityVariant and always have their static type
+    template<typename Archive>
+    void serialize(Archive& ar)
     {
-      filesystem::readStruct(in, id);
-      filesystem::readStruct(in, pos);
-      filesystem::readStruct(in, size);
-      filesystem::readStruct(in, anchor);
+      ar(id, pos, size, anchor);
     }
 };
 
@@ -5,7 +5,17 @@
  *      offers template functions for saving/loading structs or containers of structs
  *
  *  NOTES:
- *      When trying to save a struct or a vector of structs with non primitive data (string, vector, ..) it should inherit from class "Saveable" or provide methods "save" and write".
+ *      Fundamentals and trivially copyable structs without padding (vectors, forces) are written as raw bytes, so are contiguous ranges of them.
+ *      Anything else (containing strings, vectors, ..) provides a member "template<typename Archive> void serialize(Archive& ar)" listing its members: ar(a, b, c).
+ *      The same serialize member is used for reading and writing, Archive::isWriting tells them apart if ever needed.
+ *      Files are serialized into a BufferWriter and written with one call, loading reads the whole file and parses it with a SpanReader.
+ *      The stream archives are for data that is streamed, like replay logs.
+ *      writeStruct optionally compresses files (see compression.h), readStruct decompresses them transparently.
+ *      Files are sealed with a checksum (see checksum.h) and replaced atomically: written to "<file>.tmp", synced to disk and renamed
+ *      over the old one, so a crash (power loss included) leaves the old or the new file but never half of one. A complete .tmp left
+ *      by a crash before its rename is taken over by the next readStruct, a broken one is dropped.
+ *      Which of the two survives a power loss is only settled once the directory is synced (syncDirectory), Map::flush does that
+ *      once for all chunks after writing them instead of once per file.
  *      
  *  AUTHOR:        Leon Schierbach     DATE: 18.09.2018
  *
@@ -29,11 +39,33 @@
 #ifndef FILESYSTEM_HPP
 #define FILESYSTEM_HPP
 
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
 #include <vector>
 #include <fstream>
 #include <ostream>
+#include <type_traits>
+#include <utility>
 #include <variant>
 
+#include <cerrno>
+#include <fcntl.h>
+#ifdef _WIN32
+  #include <io.h>
+  #include <sys/stat.h>
+#else
+  #include <unistd.h>
+#endif
+
+#include "game/compression.h"
+#include "game/checksum.h"
+
 template<typename... Ts> struct make_void { typedef void type;};
 template<typename... Ts> using void_t = typename make_void<Ts...>::type;
 
@@ -73,177 +105,620 @@ using enable_if_t = typename std::enable_if<B,T>::type;
 
 namespace filesystem
 {
+  // totals of all files read/written through writeFile/readFile, e.g. for benchmarks
+  struct Stats
+  {
+    std::atomic<uint64_t> bytesWritten { 0 };
+    std::atomic<uint64_t> bytesRead { 0 };
+    std::atomic<uint64_t> filesWritten { 0 };
+    std::atomic<uint64_t> filesRead { 0 };
+  };
+
+  inline Stats stats;
+
+  ////////////////////// SERIALIZE //////////////////////
   
-  ////////////////////// WRITE_STRUCT /////////////////////
+  template<typename Archive, typename Value>
+  void serialize(Archive& ar, Value& value);
   
-  template<typename Struct>
-  auto writeStruct(std::ofstream& out, Struct& saveableStruct)  -> enable_if_t<!std::is_fundamental<Struct>::value && !is_variant<Struct>::value>
+  // archives only decide where the bytes go, serialize() decides which bytes
+  class StreamWriter
   {
-    out << saveableStruct;
-  }
-
-  template<typename Fundamental>
-  auto writeStruct(std::ofstream& out, Fundamental& primitive)  -> enable_if_t<std::is_fundamental<Fundamental>::value && !is_variant<Fundamental>::value>
+    private:
+      std::ofstream& m_Out;
+      
+    public:
+      static constexpr bool isWriting = true;
+      // format version of the data, see versionTag
+      uint16_t version = 0;
+      
+      explicit StreamWriter(std::ofstream& out) : m_Out(out) {}
+      
+      void bytes(const void* data, size_t size)
+      {
+        m_Out.write(static_cast<const char*>(data), size);
+      }
+      
+      template<typename... Values>
+      void operator()(Values&... values)
+      {
+        (serialize(*this, values), ...);
+      }
+  };
+  
+  class StreamReader
+  {
+    private:
+      std::ifstream& m_In;
+      
+    public:
+      static constexpr bool isWriting = false;
+      // format version of the data, see versionTag
+      uint16_t version = 0;
+      
+      explicit StreamReader(std::ifstream& in) : m_In(in) {}
+      
+      void bytes(void* data, size_t size)
+      {
+        m_In.read(static_cast<char*>(data), size);
+      }
+      
+      bool peek(void* data, size_t size)
+      {
+        auto pos = m_In.tellg();
+        m_In.read(static_cast<char*>(data), size);
+        bool complete = static_cast<bool>(m_In);
+        m_In.clear();
+        m_In.seekg(pos);
+        return complete;
+      }
+      
+      void fail()
+      {
+        m_In.setstate(std::ios::failbit);
+      }
+      
+      template<typename... Values>
+      void operator()(Values&... values)
+      {
+        (serialize(*this, values), ...);
+      }
+  };
+  
+  // serializes into memory, the whole buffer can then be written at once (or compressed, sent, ..)
+  class BufferWriter
+  {
+    private:
+      std::vector<uint8_t> m_Buffer;
+      
+    public:
+      static constexpr bool isWriting = true;
+      // format version of the data, see versionTag
+      uint16_t version = 0;
+      
+      void bytes(const void* data, size_t size)
+      {
+        if (size == 0)
+        {
+          return;
+        }
+        auto offset = m_Buffer.size();
+        m_Buffer.resize(offset + size);
+        std::memcpy(m_Buffer.data() + offset, data, size);
+      }
+      
+      template<typename... Values>
+      void operator()(Values&... values)
+      {
+        (serialize(*this, values), ...);
+      }
+      
+      void reserve(size_t size) { m_Buffer.reserve(size); }
+      void clear()              { m_Buffer.clear(); }
+      
+      const std::vector<uint8_t>& buffer() const { return m_Buffer; }
+      std::vector<uint8_t>& buffer()             { return m_Buffer; }
+  };
+  
+  // parses from memory it doesn't own. Reading past the end yields zeroes and marks the reader as failed
+  class SpanReader
+  {
+    private:
+      const uint8_t* m_Data;
+      size_t m_Size;
+      size_t m_Pos = 0;
+      bool m_Failed = false;
+      
+    public:
+      static constexpr bool isWriting = false;
+      // format version of the data, see versionTag
+      uint16_t version = 0;
+      
+      SpanReader(const uint8_t* data, size_t size) : m_Data(data), m_Size(size) {}
+      explicit SpanReader(const std::vector<uint8_t>& buffer) : SpanReader(buffer.data(), buffer.size()) {}
+      
+      void bytes(void* data, size_t size)
+      {
+        if (size == 0)
+        {
+          return;
+        }
+        if (size > m_Size - m_Pos)
+        {
+          std::memset(data, 0, size);
+          m_Pos = m_Size;
+          m_Failed = true;
+          return;
+        }
+        std::memcpy(data, m_Data + m_Pos, size);
+        m_Pos += size;
+      }
+      
+      template<typename... Values>
+      void operator()(Values&... values)
+      {
+        (serialize(*this, values), ...);
+      }
+      
+      // reads without consuming, false if there aren't enough bytes left
+      bool peek(void* data, size_t size) const
+      {
+        if (size > m_Size - m_Pos)
+        {
+          return false;
+        }
+        std::memcpy(data, m_Data + m_Pos, size);
+        return true;
+      }
+      
+      size_t remaining() const { return m_Size - m_Pos; }
+      bool failed() const      { return m_Failed; }
+      
+      // stops parsing, everything after reads zeroes
+      void fail()
+      {
+        m_Pos = m_Size;
+        m_Failed = true;
+      }
+  };
+  
+  // types with non primitive data provide "template<typename Archive> void serialize(Archive& ar)" and list their members there
+  template <typename T, typename = void>
+  struct has_serialize : public std::false_type {};
+  
+  template <typename T>
+  struct has_serialize<T, void_t<decltype(std::declval<T&>().serialize(std::declval<StreamWriter&>()))>> : public std::true_type {};
+  
+  // written as they are in memory, in one piece. Trivially copyable structs must not contain padding to qualify
+  template <typename T, typename = void>
+  struct is_trivially_serializable : public std::integral_constant<bool, 
+    std::is_arithmetic<T>::value || std::is_enum<T>::value || 
+    (std::is_class<T>::value && std::is_trivially_copyable<T>::value && !has_serialize<T>::value && !is_range<T>::value)> {};
+  
+  template <typename T, std::size_t N>
+  struct is_trivially_serializable<std::array<T, N>> : public is_trivially_serializable<T> {};
+  
+  template <typename T, typename = void>
+  struct is_contiguous : public std::false_type {};
+  
+  template <typename T>
+  struct is_contiguous<T, void_t<decltype(std::declval<T&>().data()), decltype(std::declval<T&>().resize(0))>> : public std::true_type {};
+  
+  template <typename T>
+  struct dependent_false : public std::false_type {};
+  
+  template <std::size_t I, typename Archive, typename Variant>
+  void loadVariantType(Archive& ar, Variant& variant, uint32_t index)
   {
-    out.write(reinterpret_cast<const char*>(&primitive), sizeof(Fundamental));
+    if (index == I)
+    {
+      serialize(ar, variant.template emplace<I>());
+    }
   }
 
-  template<typename Struct>
-  void writeStruct(const std::string& filePath, Struct& strct) 
+  template <typename Archive, typename Variant, std::size_t... I>
+  void loadVariantImpl(Archive& ar, Variant& variant, uint32_t index, std::index_sequence<I...>)
   {
-    std::ofstream fstream(filePath, std::ios::out | std::ios::binary);
-    writeStruct(fstream, strct);
+    (loadVariantType<I>(ar, variant, index), ...);
   }
   
-  ////////////////////// WRITE_VARIANT /////////////////////
-
-  template <typename Variant>
-  auto writeStruct(std::ofstream& out, Variant& variant)  -> enable_if_t<is_variant<Variant>::value>
+  template <typename Archive, typename Variant>
+  void serializeVariant(Archive& ar, Variant& variant)
   {
     uint32_t index = variant.index();
-    writeStruct<uint32_t>(out, index);
+    ar.bytes(&index, sizeof(index));
     
-    std::visit
-    ([&](auto&& arg) -> void
-      {
-        writeStruct(out, arg);
-      }, variant
-    );
+    if constexpr (Archive::isWriting)
+    {
+      std::visit([&](auto&& arg) -> void { serialize(ar, arg); }, variant);
+    }
+    else
+    {
+      loadVariantImpl(ar, variant, index, std::make_index_sequence<std::variant_size_v<Variant>> { });
+    }
   }
   
-  ////////////////////// WRITE_RANGE //////////////////////
+  template <typename T, typename = void>
+  struct has_remaining : public std::false_type {};
+  
+  template <typename T>
+  struct has_remaining<T, void_t<decltype(std::declval<T&>().remaining())>> : public std::true_type {};
   
-  template <typename Struct>
-  auto writeRange(std::ofstream& out, Struct& strct)            -> enable_if_t<!is_range<Struct>::value>
+  // lower bound of the bytes a value takes, used to reject element counts the rest of a file can't hold
+  template <typename T>
+  constexpr size_t minSerializedSize()
   {
-    writeStruct(out, strct);
+    if constexpr (is_trivially_serializable<T>::value)
+    {
+      return sizeof(T);
+    }
+    else if constexpr (is_array<T>::value)
+    {
+      return std::tuple_size<T>::value * minSerializedSize<typename T::value_type>();
+    }
+    else if constexpr (is_variant<T>::value || is_range<T>::value)
+    {
+      return sizeof(uint32_t);
+    }
+    else
+    {
+      // serialize members are opaque, assume they write at least one byte
+      return 1;
+    }
   }
-
-  template<typename Range>
-  auto writeRange(std::ofstream& out, Range& currentRange)      -> enable_if_t<is_range<Range>::value && !is_array<Range>::value>
+  
+  // uint32 element count followed by the elements, contiguous ranges of trivial elements in one piece
+  template <typename Archive, typename Range>
+  void serializeRange(Archive& ar, Range& range)
   {
-    uint32_t size = currentRange.size();
-    writeStruct<uint32_t>(out, size);
+    using Elem = typename Range::value_type;
+    
+    uint32_t size = range.size();
+    ar.bytes(&size, sizeof(size));
     
-    for(auto& elem : currentRange)
+    if constexpr (!Archive::isWriting)
+    {
+      if constexpr (has_remaining<Archive>::value)
+      {
+        // a corrupt count must not turn into a giant allocation
+        if (size > ar.remaining() / minSerializedSize<Elem>())
+        {
+          ar.fail();
+          range.clear();
+          return;
+        }
+      }
+      
+      if constexpr (!is_contiguous<Range>::value)
+      {
+        range.clear();
+        for (auto i = 0u; i < size; i++)
+        {
+          serialize(ar, range.emplace_back());
+        }
+        return;
+      }
+      else if constexpr (is_trivially_serializable<Elem>::value)
+      {
+        // no clear, the bytes get overwritten anyway
+        range.resize(size);
+      }
+      else
+      {
+        // elements are deserialized in place, start from default constructed ones
+        range.clear();
+        range.resize(size);
+      }
+    }
+    
+    if constexpr (is_contiguous<Range>::value && is_trivially_serializable<Elem>::value)
+    {
+      ar.bytes(range.data(), size * sizeof(Elem));
+    }
+    else
+    {
+      for (auto& elem : range)
+      {
+        serialize(ar, elem);
+      }
+    }
+  }
+  
+  template<typename Archive, typename Value>
+  void serialize(Archive& ar, Value& value)
+  {
+    if constexpr (is_variant<Value>::value)
+    {
+      serializeVariant(ar, value);
+    }
+    else if constexpr (has_serialize<Value>::value)
     {
-      writeRange(out, elem);
+      value.serialize(ar);
+    }
+    else if constexpr (is_trivially_serializable<Value>::value)
+    {
+      ar.bytes(&value, sizeof(Value));
+    }
+    else if constexpr (is_array<Value>::value)
+    {
+      for (auto& elem : value)
+      {
+        serialize(ar, elem);
+      }
+    }
+    else if constexpr (is_range<Value>::value)
+    {
+      serializeRange(ar, value);
+    }
+    else
+    {
+      static_assert(dependent_false<Value>::value, "type needs a serialize(Archive&) member or has to be trivially copyable");
     }
   }
   
-  template<typename Array>
-  auto writeRange(std::ofstream& out, Array& arr)      -> enable_if_t<is_array<Array>::value>
+  // magic + uint16 version in front of versioned data. Sets ar.version to the version of the data, readers get 0 if the data
+  // starts without the magic (written before it was versioned) and fail on versions newer than current
+  template<typename Archive>
+  void versionTag(Archive& ar, const char (&magic)[4], uint16_t current)
   {
-    for (auto i = 0u; i < arr.size(); i++)
+    if constexpr (Archive::isWriting)
     {
-      writeRange(out, arr[i]);
+      ar.bytes(magic, sizeof(magic));
+      ar.bytes(&current, sizeof(current));
+      ar.version = current;
+    }
+    else
+    {
+      char found[sizeof(magic)];
+      if (!ar.peek(found, sizeof(found)) || std::memcmp(found, magic, sizeof(magic)) != 0)
+      {
+        ar.version = 0;
+        return;
+      }
+      
+      ar.bytes(found, sizeof(found));
+      ar.bytes(&ar.version, sizeof(ar.version));
+      
+      if (ar.version > current)
+      {
+        ar.fail();
+      }
     }
   }
   
-  template <typename Range>
-  void writeRange(const std::string& filePath, Range& range)
+  // lets a struct append members and still read files written before: true once a reader has nothing left
+  template<typename Archive>
+  bool atEnd(Archive& ar)
   {
-    std::ofstream fstream(filePath, std::ios::out | std::ios::binary);
-    writeRange(fstream, range);
+    if constexpr (!Archive::isWriting && has_remaining<Archive>::value)
+    {
+      return ar.remaining() == 0;
+    }
+    else
+    {
+      return false;
+    }
   }
   
-  ////////////////////// READ_STRUCT //////////////////////
+  ////////////////////// FILES //////////////////////////
   
+  static constexpr const char* tempSuffix = ".tmp";
   
-  template <typename Variant, typename Indices = std::make_index_sequence<std::variant_size_v<Variant>>>
-  auto readVariant(std::ifstream& in, Variant& variant) -> void;
+  // writes and recoveries of the same file must not interleave (e.g. two saves of one chunk), they share a mutex by path
+  inline std::mutex& fileMutex(const std::string& filePath)
+  {
+    static std::array<std::mutex, 64> mutexes;
+    return mutexes[std::hash<std::string>{}(filePath) % mutexes.size()];
+  }
   
-  template<typename Variant>
-  auto readStruct(std::ifstream& in, Variant& variant)    -> enable_if_t<(is_variant<Variant>::value)>
+  // writes the whole buffer and waits until it is on the disk
+  inline bool writeSynced(const std::string& filePath, const std::vector<uint8_t>& buffer)
   {
-    readVariant(in, variant);
+#ifdef _WIN32
+    int fd = _open(filePath.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+    int fd = ::open(filePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+    if (fd < 0)
+    {
+      return false;
+    }
+    
+    bool written = true;
+    for (size_t offset = 0; offset < buffer.size() && written;)
+    {
+      // write may take less than asked for
+#ifdef _WIN32
+      auto result = _write(fd, buffer.data() + offset, static_cast<unsigned>(buffer.size() - offset));
+#else
+      auto result = ::write(fd, buffer.data() + offset, buffer.size() - offset);
+#endif
+      if (result > 0)
+      {
+        offset += static_cast<size_t>(result);
+      }
+      else
+      {
+        written = result < 0 && errno == EINTR;
+      }
+    }
+    
+#ifdef _WIN32
+    written = written && _commit(fd) == 0;
+    return _close(fd) == 0 && written;
+#else
+    written = written && ::fsync(fd) == 0;
+    return ::close(fd) == 0 && written;
+#endif
   }
   
-  template<typename Struct>
-  auto readStruct(std::ifstream& in, Struct& saveableStruct)    -> enable_if_t<(!std::is_fundamental<Struct>::value && !is_variant<Struct>::value)>
+  // makes the renames inside dir survive a power loss, one call covers every file renamed there before it
+  inline bool syncDirectory(const std::string& dir)
   {
-    in >> saveableStruct;
+#ifdef _WIN32
+    // directories can't be opened for syncing, NTFS journals renames itself
+    return true;
+#else
+    int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0)
+    {
+      return false;
+    }
+    bool synced = ::fsync(fd) == 0;
+    return ::close(fd) == 0 && synced;
+#endif
   }
-
-  template<typename Fundamental>
-  auto readStruct(std::ifstream& in, Fundamental& primitive)    -> enable_if_t<(std::is_fundamental<Fundamental>::value && !is_variant<Fundamental>::value)>
+  
+  // one write call for the whole file, into a temporary file that is synced and then replaces filePath
+  inline bool writeFile(const std::string& filePath, const std::vector<uint8_t>& buffer)
+  {
+    std::scoped_lock lock(fileMutex(filePath));
+    auto tempPath = filePath + tempSuffix;
+    std::error_code error;
+    
+    // renamed before its data is on the disk, a power loss could leave filePath empty or partial
+    if (!writeSynced(tempPath, buffer))
+    {
+      std::filesystem::remove(tempPath, error);
+      return false;
+    }
+    
+    std::filesystem::rename(tempPath, filePath, error);
+    if (error)
+    {
+      return false;
+    }
+    
+    stats.bytesWritten += buffer.size();
+    stats.filesWritten++;
+    return true;
+  }
+  
+  // one read call for the whole file
+  inline bool readFile(const std::string& filePath, std::vector<uint8_t>& buffer)
   {
-    in.read(reinterpret_cast<char*>(&primitive), sizeof(Fundamental));
+    std::ifstream fstream(filePath, std::ios::in | std::ios::binary | std::ios::ate);
+    buffer.clear();
+    
+    if (!fstream.is_open())
+    {
+      return false;
+    }
+    
+    auto size = fstream.tellg();
+    if (size <= 0)
+    {
+      return size == 0;
+    }
+    
+    buffer.resize(static_cast<size_t>(size));
+    fstream.seekg(0);
+    fstream.read(reinterpret_cast<char*>(buffer.data()), buffer.size());
+    
+    if (!fstream)
+    {
+      buffer.clear();
+      return false;
+    }
+    stats.bytesRead += buffer.size();
+    stats.filesRead++;
+    return true;
   }
-
-  template<typename Struct>
-  void readStruct(const std::string& filePath, Struct& strct) 
+  
+  // a temporary file still there was written by a process that died before renaming it: complete ones (sealed, checksum ok)
+  // are newer than filePath and replace it, anything else is removed. True if filePath was replaced
+  inline bool recoverFile(const std::string& filePath)
   {
-    std::ifstream fstream(filePath, std::ios::in | std::ios::binary);
-    readStruct(fstream, strct);
+    std::scoped_lock lock(fileMutex(filePath));
+    auto tempPath = filePath + tempSuffix;
+    std::error_code error;
+    
+    if (!std::filesystem::exists(tempPath, error))
+    {
+      return false;
+    }
+    
+    std::vector<uint8_t> buffer;
+    if (readFile(tempPath, buffer) && checksum::isSealed(buffer) && checksum::unseal(buffer))
+    {
+      std::filesystem::rename(tempPath, filePath, error);
+      return !error;
+    }
+    
+    std::filesystem::remove(tempPath, error);
+    return false;
   }
   
-  ////////////////////// READ_VARIANT //////////////////////
+  ////////////////////// WRITE ////////////////////////////
   
-  template <std::size_t I, typename Variant>
-  auto loadVariantType(std::ifstream& in, Variant& variant, size_t index)
+  template<typename Struct>
+  void writeStruct(std::ofstream& out, Struct& strct)
   {
-      if (index == I)
-      {
-          using T = std::decay_t<decltype(std::get<I>(variant))>;
-          T result;
-          readStruct(in, result);
-          variant = result;
-      }
+    StreamWriter ar(out);
+    serialize(ar, strct);
   }
 
-  template <typename Variant, std::size_t... I>
-  auto loadVariantImpl(std::ifstream& in, size_t index, Variant& variant, std::index_sequence<I...>) -> void
+  template<typename Struct>
+  bool writeStruct(const std::string& filePath, Struct& strct, compression::Codec codec = compression::Codec::None) 
   {
-      (loadVariantType<I>(in, variant, index), ...);
+    BufferWriter ar;
+    serialize(ar, strct);
+    
+    std::vector<uint8_t> packed;
+    compression::pack(codec, ar.buffer(), packed);
+    checksum::seal(packed);
+    return writeFile(filePath, packed);
   }
-
-  template <typename Variant, typename Indices = std::make_index_sequence<std::variant_size_v<Variant>>>
-  auto readVariant(std::ifstream& in, Variant& variant) -> void// std::enable_if_t<is_variant<Variant>::value, void>
+  
+  template <typename Range>
+  void writeRange(std::ofstream& out, Range& range)
   {
-      uint32_t index;
-      readStruct<uint32_t>(in, index);
-      loadVariantImpl(in, index, variant, Indices { });
+    writeStruct(out, range);
   }
-
-  /////////////////////// READ_RANGE //////////////////////
+  
+  template <typename Range>
+  bool writeRange(const std::string& filePath, Range& range)
+  {
+    return writeStruct(filePath, range);
+  }
+  
+  ////////////////////// READ /////////////////////////////
   
   template<typename Struct>
-  auto readRange(std::ifstream& in, Struct& strct)              -> enable_if_t<!is_range<Struct>::value>
+  void readStruct(std::ifstream& in, Struct& strct)
   {
-    readStruct(in, strct);
+    StreamReader ar(in);
+    serialize(ar, strct);
   }
 
-  template<typename Range>
-  auto readRange(std::ifstream& in, Range& range)               -> enable_if_t<is_range<Range>::value && !is_array<Range>::value>
+  // false if the file is missing, fails its checksum, is broken or shorter than what strct expects.
+  // Compressed files are detected by their header
+  template<typename Struct>
+  bool readStruct(const std::string& filePath, Struct& strct) 
   {
-    uint32_t size;
-    readStruct<uint32_t>(in, size);
+    recoverFile(filePath);
     
-    for (auto i = 0u; i < size; i++)
+    std::vector<uint8_t> buffer;
+    if (!readFile(filePath, buffer) || !checksum::unseal(buffer) || !compression::unpack(buffer))
     {
-      typename Range::value_type elem;
-      readRange(in, elem);
-      range.push_back(elem);
+      return false;
     }
+    
+    SpanReader ar(buffer);
+    serialize(ar, strct);
+    return !ar.failed();
   }
-
-  template<typename Array>
-  auto readRange(std::ifstream& in, Array& arr)               -> enable_if_t<is_array<Array>::value>
+  
+  template<typename Range>
+  void readRange(std::ifstream& in, Range& range)
   {
-    for (auto i = 0u; i < arr.size(); i++)
-    {
-      typename Array::value_type elem;
-      readRange(in, elem);
-      arr[i] = elem;
-    }
+    readStruct(in, range);
   }
 
   template<typename Range>
-  void readRange(const std::string& filePath, Range& range)
+  bool readRange(const std::string& filePath, Range& range)
   {
-    std::ifstream filestream(filePath, std::ios::in | std::ios::binary);
-    readRange(filestream, range);
+    return readStruct(filePath, range);
   }
   
   ////////////////////// NON_TEMPLATE /////////////////////
@@ -4,7 +4,7 @@
 #include "game/vector.hpp"
 namespace game
 {
-  struct Force : public Saveable
+  struct Force
   {
     Force() {}
     
@@ -15,54 +15,15 @@ namespace game
       m_LifeTime = lifeTime;
     }
 
-    Force(const Force& cpy)
-    {
-      m_Force = cpy.m_Force;
-      m_Dir = cpy.m_Dir;
-      m_LifeTime = cpy.m_LifeTime;
-    }
-    
-    Force& operator=(const Force& asgn)
-    {
-      m_Force = asgn.m_Force;
-      m_Dir = asgn.m_Dir;
-      m_LifeTime = asgn.m_LifeTime;
-      return *this;
-    }
-    
-    Force(const Force&& rhs)
-    {
-      m_Force = std::move(rhs.m_Force);
-      m_Dir = std::move(rhs.m_Dir);
-      m_LifeTime = rhs.m_LifeTime;
-    }
-    
-    Force& operator=(const Force&& rhs)
-    {
-      m_Force = std::move(rhs.m_Force);
-      m_Dir = std::move(rhs.m_Dir);
-      m_LifeTime = rhs.m_LifeTime;
-      return *this;
-    }
-    
-    void write(std::ofstream& out) override
-    {
-      filesystem::writeStruct(out, m_LifeTime);
-      filesystem::writeStruct(out, m_Force);
-      filesystem::writeStruct(out, m_Dir);
-    }
-    
-    void read(std::ifstream& in) override
-    {
-      filesystem::readStruct(in, m_LifeTime);
-      filesystem::readStruct(in, m_Force);
-      filesystem::readStruct(in, m_Dir);
-    }
-    
+    Force(const Force& cpy) = default;
+    Force& operator=(const Force& asgn) = default;
     
     float m_LifeTime;
     game::vec2<float> m_Force;
     game::vec2<float> m_Dir;
   };
+  
+  // saved as raw bytes, any padding would end up in the files
+  static_assert(sizeof(Force) == 5 * sizeof(float) && std::is_trivially_copyable<Force>::value, "Force must stay a packed pod");
 }
 #endif
\ No newline at end of file
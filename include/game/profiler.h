@@ -0,0 +1,88 @@
+/*
+ *  FILENAME:      profiler.h
+ *
+ *  DESCRIPTION:
+ *      Scoped timing zones recorded into per-thread ring buffers, with percentile summaries and Chrome trace export
+ *
+ *  PUBLIC FUNCTIONS:
+ *      PROFILE_ZONE(name)
+ *      void        setEnabled(bool enabled)
+ *      summary()
+ *      void        printSummary()
+ *      bool        writeChromeTrace(const std::string& path)
+ *
+ *  NOTES:
+ *      Recording never locks: every thread owns a single-producer ring buffer, only registering a new thread/zone takes a mutex.
+ *      Buffers of finished threads (chunk I/O threads are short lived) are handed to the next new thread, their events stay readable until overwritten.
+ *      Every entry carries a sequence number (seqlock), summaries taken while threads record drop the entries being overwritten.
+ *      Summaries and traces cover the events still inside the ring buffers, i.e. the last bufferCapacity zones per thread.
+ *      Define BLUB_NO_PROFILER to compile all zones out.
+ *
+ */
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace profiler
+{
+  static constexpr size_t bufferCapacity = 8192;
+
+  struct ZoneStats
+  {
+    std::string name;
+    size_t count;
+    float p50;
+    float p99;
+    float max;
+  };
+
+  uint16_t registerZone(const char* name);
+
+  void setEnabled(bool enabled);
+  bool isEnabled();
+
+  uint64_t now();
+  void record(uint16_t zone, uint64_t start, uint64_t end);
+
+  // durations in milliseconds, one entry per zone that has events
+  std::vector<ZoneStats> summary();
+  void printSummary();
+  bool writeChromeTrace(const std::string& path);
+
+  class ScopedZone
+  {
+    private:
+      uint16_t m_Zone;
+      uint64_t m_Start;
+
+    public:
+      explicit ScopedZone(uint16_t zone) : m_Zone(zone), m_Start(isEnabled() ? now() : 0) {}
+      ~ScopedZone()
+      {
+        if (m_Start != 0)
+        {
+          record(m_Zone, m_Start, now());
+        }
+      }
+
+      ScopedZone(const ScopedZone&)            = delete;
+      ScopedZone& operator=(const ScopedZone&) = delete;
+  };
+}
+
+#define PROFILER_CONCAT_INNER(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_INNER(a, b)
+
+#ifdef BLUB_NO_PROFILER
+  #define PROFILE_ZONE(name)
+#else
+  #define PROFILE_ZONE(name) \
+    static const uint16_t PROFILER_CONCAT(profilerZoneId, __LINE__) = profiler::registerZone(name); \
+    profiler::ScopedZone PROFILER_CONCAT(profilerZone, __LINE__) { PROFILER_CONCAT(profilerZoneId, __LINE__) }
+#endif
+
+#endif /* PROFILER_H */
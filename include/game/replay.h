@@ -0,0 +1,109 @@
+/*
+ *  FILENAME:      replay.h
+ *
+ *  DESCRIPTION:
+ *      Binary log of per tick input/tick data and the model side of input handling, so recorded sessions can be replayed headless
+ *
+ *  PUBLIC FUNCTIONS:
+ *      bool        Recorder::open(const std::string& path)
+ *      void        Recorder::record(const Frame& frame)
+ *      bool        Player::open(const std::string& path)
+ *      bool        Player::next(Frame& frame)
+ *      void        Input::click(Map& map, game::vec2<float> pos)
+ *      Entity*     Input::moveSelected(Map& map, uint32_t keys)
+ *
+ *  NOTES:
+ *      Cameras are tracked entities, their positions decide which chunks are loaded. A frame therefore stores them instead of
+ *      the renderer state that moved them, clicks are stored as world positions for the same reason.
+ *      Editor edits aren't part of a frame, they're tied to the renderer. Replay a session against a copy of the map it was recorded on.
+ *
+ *      File layout: "BRPL", uint16 version, then per frame:
+ *        float tickDuration, uint16 keys, uint8 cameraCount, cameraCount * (float x, float y), uint8 clickCount, clickCount * (float x, float y)
+ *
+ */
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "game/vector.hpp"
+
+class Map;
+class Entity;
+
+namespace replay
+{
+  static constexpr char magic[4] = { 'B', 'R', 'P', 'L' };
+  static constexpr uint16_t version = 1;
+
+  // bits of Frame::keys, only the keys Controller::handleInput reacts to
+  enum Key : uint16_t
+  {
+    KEY_W = 1 << 0,
+    KEY_A = 1 << 1,
+    KEY_S = 1 << 2,
+    KEY_D = 1 << 3,
+    KEY_E = 1 << 4,
+    KEY_Q = 1 << 5,
+    KEY_R = 1 << 6,
+    KEY_F = 1 << 7,
+    KEY_V = 1 << 8
+  };
+
+  struct Frame
+  {
+    float tickDuration = 0.f;
+    uint16_t keys = 0;
+    std::vector<game::vec2<float>> cameras;
+    std::vector<game::vec2<float>> clicks;
+
+    void clear();
+  };
+
+  class Recorder
+  {
+    private:
+      std::ofstream m_Out;
+
+    public:
+      bool open(const std::string& path);
+      bool isOpen() const;
+      void record(const Frame& frame);
+  };
+
+  class Player
+  {
+    private:
+      std::ifstream m_In;
+
+    public:
+      bool open(const std::string& path);
+      // false at the end of the log or on a truncated frame
+      bool next(Frame& frame);
+  };
+
+  // movement direction of WASD, one unit per pressed key and not normalized (diagonals are faster), recorded sessions rely on it
+  game::vec2<float> moveDirection(uint16_t keys);
+
+  // what Controller's input does to the model, shared with headless replays so both stay identical
+  class Input
+  {
+    private:
+      uint32_t m_SelectedEntityId = 0;
+
+    public:
+      uint32_t getSelectedEntityId() const;
+
+      // selects the entity at pos, or pushes physics entities away if nothing was selected before
+      void click(Map& map, game::vec2<float> pos);
+
+      // moves the selected entity, nullptr if there is none (anymore)
+      Entity* moveSelected(Map& map, uint16_t keys);
+  };
+}
+
+#endif /* REPLAY_H */
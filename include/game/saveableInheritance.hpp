@@ -1,11 +0,0 @@
-#ifndef SAVEABLEINHERITANCE_HPP
-#define SAVEABLEINHERITANCE_HPP
-
-#include "saveable.h"
-
-struct saveableInerhitance : public Saveable
-{
-  
-};
-
-#endif /* SAVEABLEINHERITANCE_HPP */
\ No newline at end of file
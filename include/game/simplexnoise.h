@@ -10,6 +10,7 @@
 #pragma once
 
 #include <cstddef>  // size_t
+#include <cstdint>  // uint8_t/uint32_t
 
 /**
  * @brief A Perlin Simplex Noise C++ Implementation (1D, 2D, 3D, 4D).
@@ -17,19 +18,23 @@
 class SimplexNoise {
 public:
     // 1D Perlin simplex noise
-    static float noise(float x);
+    float noise(float x) const;
     // 2D Perlin simplex noise
-    static float noise(float x, float y);
+    float noise(float x, float y) const;
+    // 2D Perlin simplex noise of count points, four at a time where SSE2 is available
+    void noise(const float* x, const float* y, float* out, size_t count) const;
     // 3D Perlin simplex noise
-    static float noise(float x, float y, float z);
+    float noise(float x, float y, float z) const;
 
     // Fractal/Fractional Brownian Motion (fBm) noise summation
     float fractal(size_t octaves, float x) const;
     float fractal(size_t octaves, float x, float y) const;
+    // fBm over the grid of xs (columns) and ys (rows), out is row by row
+    void fractal(size_t octaves, const float* xs, size_t width, const float* ys, size_t height, float* out) const;
     float fractal(size_t octaves, float x, float y, float z) const;
 
     /**
-     * Constructor of to initialize a fractal noise summation
+     * Constructor of to initialize a fractal noise summation, with Ken Perlin's permutation table
      *
      * @param[in] frequency    Frequency ("width") of the first octave of noise (default to 1.0)
      * @param[in] amplitude    Amplitude ("height") of the first octave of noise (default to 1.0)
@@ -39,17 +44,29 @@ public:
     explicit SimplexNoise(float frequency = 1.0f,
                           float amplitude = 1.0f,
                           float lacunarity = 2.0f,
-                          float persistence = 0.5f) :
-        mFrequency(frequency),
-        mAmplitude(amplitude),
-        mLacunarity(lacunarity),
-        mPersistence(persistence) {
-    }
+                          float persistence = 0.5f);
+
+    /**
+     * Same with a permutation table shuffled from seed, the same seed gives the same noise on every platform
+     *
+     * Instances don't change after construction, one can be used from many threads at once.
+     */
+    SimplexNoise(uint32_t seed,
+                 float frequency,
+                 float amplitude = 1.0f,
+                 float lacunarity = 2.0f,
+                 float persistence = 0.5f);
 
 private:
+    // Hash an integer using the permutation table
+    uint8_t hash(int32_t i) const;
+
     // Parameters of Fractional Brownian Motion (fBm) : sum of N "octaves" of noise
     float mFrequency;   ///< Frequency ("width") of the first octave of noise (default to 1.0)
     float mAmplitude;   ///< Amplitude ("height") of the first octave of noise (default to 1.0)
     float mLacunarity;  ///< Lacunarity specifies the frequency multiplier between successive octaves (default to 2.0).
     float mPersistence; ///< Persistence is the loss of amplitude between successive octaves (usually 1/lacunarity)
+
+    /// Permutation table (a jumble of 0-255), read by every noise call. Starts on a cache line, so it spans exactly 4
+    alignas(64) uint8_t mPerm[256];
 };
\ No newline at end of file
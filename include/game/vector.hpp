@@ -22,7 +22,6 @@
 #include <array>
 #include <cmath>
 
-#include "game/saveable.h"
 #include "game/filesystem.hpp"
 
 namespace game
@@ -33,7 +32,8 @@ namespace game
   static constexpr float epsilon = 0.0001f;
 
   template <size_t N, typename Type = float>
-  class Vector : public Saveable
+  // trivially copyable on purpose, filesystem writes vectors (and structs of them) as raw bytes
+  class Vector
   {
     private:
       std::array<Type, N> data;
@@ -48,15 +48,9 @@ namespace game
       // construct initializerlist
       Vector(const Type (&arr)[N]) { for(auto i = 0u; i < N; i++) { data[i] = arr[i]; } };
 
-      // copy
-      Vector(const Vector<N, Type>& cpy) : data(cpy.data) { };
-      // copy assign
-      Vector& operator=(const Vector<N, Type>& asgn) { data = asgn.data; return *this; };
-
-      // move
-      Vector(const Vector<N, Type>&& rhs) : data(std::move(rhs.data)) {};
-      // move assign
-      Vector& operator=(const Vector<N, Type>&& rhs) { data = std::move(rhs.data); return *this; };
+      // copy/move
+      Vector(const Vector<N, Type>& cpy) = default;
+      Vector& operator=(const Vector<N, Type>& asgn) = default;
 
       // destruct
       ~Vector() = default;
@@ -106,22 +100,6 @@ namespace game
       
       friend inline auto  operator!=(const Vector<N, Type>& lhs, const Vector<N, Type>& rhs)  { return !(lhs == rhs); };
       
-      void write(std::ofstream& out) override
-      {
-        for(auto i= 0u; i < N; i++)
-        {
-          filesystem::writeStruct(out, data[i]);
-        }
-      }
-      
-      void read(std::ifstream& in) override
-      {
-        for(auto i= 0u; i < N; i++)
-        {
-          filesystem::readStruct(in, data[i]);
-        }
-      }
-      
       void print()
       {
         printf("Vector<%u>[\n", N);
@@ -10,6 +10,10 @@
  *  NOTES:
  *      When changing the position, the chunk will first save its data and then load the new one. This is done in "void reload()".
  *      Also, when the chunk is destroyed, it will save its data as well
+ *      A save only writes what changed: nothing if nothing did, the changed/removed entities appended to "<x>.<y>.tdat.log" if only entities did,
+ *      and a full .tdat (which empties the log) otherwise or once the log would outgrow a full save. Loading applies the log to the .tdat.
+ *      Chunks without a file are generated and count as saved: the generator can make them again, so they aren't written until changed.
+ *      New tiles (saved, generated or loaded the first time) are drawn into the map's Overview.
  *
  *  AUTHOR:         Leon Schierbach     DATE: 12.09.2018
  *
@@ -28,10 +32,13 @@
 
 #include <thread>   //std::thread
 #include <mutex>    //std::mutex
+#include <atomic>   //std::atomic
 
 #include <vector>   //std::vector
+#include <unordered_map>
 
 #include "structs/tileset.h"
+#include "structs/gamelayer.h"
 #include "game/vector.hpp"
 #include "game/entities/physicsEntity.h"
 #include "game/filesystem.hpp"
@@ -44,9 +51,9 @@ class Chunk
   private:
     
     using tilesetVector = std::vector<Tileset>;
-    using gameLayer = std::array<std::array<char, game::math::chunkSize>, game::math::chunkSize>;
+    using gameLayer = GameLayer<game::math::chunkSize>;
   
-    const std::string chunkFolder = "data/map/chunks/";
+    static inline const std::string chunkFolder = "data/map/chunks/";
       
     std::thread m_saveThread;
     std::thread m_reloadThread;
@@ -57,7 +64,7 @@ class Chunk
     void reload();
 
     void save();
-    void load();
+    bool load();
     void generate();
 
     game::vec2<int> m_pos;
@@ -66,29 +73,79 @@ class Chunk
  
     Map* m_Map;
     
+    // set by flush(), the destructor doesn't save again
+    bool m_Flushed = false;
+    
+    // changes with the tiles and game layer, unique over all chunks so a slot showing another chunk notices as well
+    std::atomic<uint64_t> m_Revision { 0 };
+    static std::atomic<uint64_t> s_NextRevision;
+    
+    // what the files of the chunk hold at the moment, save() compares against it
+    struct SavedState
+    {
+      uint32_t snapshotId = 0;
+      uint64_t staticHash = 0;
+      std::unordered_map<uint32_t, uint64_t> entityHashes;
+      size_t snapshotBytes = 0;
+      size_t logBytes = 0;
+    };
+    
+    SavedState m_Saved;
+    
+    // one record of the delta log
+    struct EntityDelta
+    {
+      game::EntityVector changed;
+      std::vector<uint32_t> removed;
+      
+      template<typename Archive>
+      void serialize(Archive& ar)
+      {
+        ar(changed, removed);
+      }
+    };
+    
   public:
+    using cellMask = CellMask<game::math::chunkSize>;
  
-    struct Data : public Saveable
+    struct Data
     {
       gameLayer m_GameLayer;
       tilesetVector m_Tilesets;
       game::EntityVector m_Entities;
+      // counts the full saves, delta log records name the one they apply to
+      uint32_t m_SnapshotId = 0;
       
-      void write(std::ofstream& out) override
-      {
-        filesystem::writeRange(out, m_GameLayer);
-        filesystem::writeRange(out, m_Tilesets);
-        filesystem::writeRange(out, m_Entities);
-      }
+      // version 1: sparse tile layers, version 2: snapshot id
+      static constexpr char magic[4] = { 'B', 'C', 'H', 'K' };
+      static constexpr uint16_t version = 2;
       
-      void read(std::ifstream& in) override
+      template<typename Archive>
+      void serialize(Archive& ar)
       {
-        filesystem::readRange(in, m_GameLayer);
-        filesystem::readRange(in, m_Tilesets);
-        filesystem::readRange(in, m_Entities);
+        filesystem::versionTag(ar, magic, version);
+        ar(m_GameLayer, m_Tilesets, m_Entities);
+        
+        if (ar.version >= 2)
+        {
+          ar(m_SnapshotId);
+        }
       }
     };
     
+    // counted over all chunks, e.g. for benchmarks
+    struct Stats
+    {
+      std::atomic<uint64_t> loads { 0 };
+      std::atomic<uint64_t> saves { 0 };
+      std::atomic<uint64_t> deltaSaves { 0 };
+      std::atomic<uint64_t> generated { 0 };
+      // generated ones taken from Map's generation cache
+      std::atomic<uint64_t> generatedCached { 0 };
+    };
+    
+    static Stats stats;
+    
     Chunk(int x, int y, Map* map);
     ~Chunk();
     
@@ -97,14 +154,35 @@ class Chunk
     void setPos(game::vec2<int> pos);
     game::EntityVector tick();
     
+    // saves in the calling thread and waits for running I/O, for shutting down many chunks at once (see Map::flush)
+    void flush();
+    // saves in the background, usually just appends to the delta log
+    void autosave();
+    // writes a full .tdat now, even if the chunk holds nothing but what the generator made (see blub_pregen)
+    void saveFull();
+    
     Data m_Data;
     
     game::vec2<int> getPos() const;
     
+    // .tdat of the chunk at pos, relative to the working directory like the map folder
+    static std::string filePath(game::vec2<int> pos);
+    
     game::vec2<int> worldToTilePosition(game::vec2<float> worldPos) const;
     
     void lockData();
     void unlockData();
+    
+    // whoever changes m_Data's tiles or game layer calls touch(), views of them compare getRevision() (see Minimap)
+    void touch();
+    uint64_t getRevision() const;
+    
+  private:
+    std::string filePath() const;
+    // hashes and sizes as save() would write them
+    static SavedState summarize(Data& data);
+    // writes data as a new .tdat and clears the delta log, current is summarize(data)
+    void writeSnapshot(Data& data, SavedState current);
 };
 
 #endif /* CHUNK_H */
@@ -0,0 +1,71 @@
+/*
+ *  FILENAME:      generationcache.h
+ *
+ *  DESCRIPTION:
+ *      The last generated chunks by seed and position, so chunks streaming out and back in unchanged aren't generated again
+ *
+ *  PUBLIC FUNCTIONS:
+ *      bool        get(uint32_t seed, game::vec2<int> pos, Chunk::Data& data)
+ *      void        put(uint32_t seed, game::vec2<int> pos, const Chunk::Data& data)
+ *
+ *  NOTES:
+ *      Holds game layer and tilesets only, entities are never generated. Past the capacity the least recently used chunk is dropped.
+ *      Threadsafe, chunks generate on their reload threads.
+ *
+ */
+
+#ifndef GENERATIONCACHE_H
+#define GENERATIONCACHE_H
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+#include "logic/chunk.h"
+
+class GenerationCache
+{
+  public:
+    explicit GenerationCache(size_t capacity);
+
+    // copies game layer and tilesets into data, false if the chunk isn't cached
+    bool get(uint32_t seed, game::vec2<int> pos, Chunk::Data& data);
+    void put(uint32_t seed, game::vec2<int> pos, const Chunk::Data& data);
+
+    size_t size();
+
+  private:
+    struct Key
+    {
+      uint32_t seed;
+      int x;
+      int y;
+
+      bool operator==(const Key& other) const
+      {
+        return seed == other.seed && x == other.x && y == other.y;
+      }
+    };
+
+    struct KeyHash
+    {
+      size_t operator()(const Key& key) const;
+    };
+
+    struct Entry
+    {
+      Key key;
+      decltype(Chunk::Data::m_GameLayer) gameLayer;
+      decltype(Chunk::Data::m_Tilesets) tilesets;
+    };
+
+    // most recently used first
+    std::list<Entry> m_Entries;
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> m_Index;
+    size_t m_Capacity;
+
+    std::mutex m_Mutex;
+};
+
+#endif /* GENERATIONCACHE_H */
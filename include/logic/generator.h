@@ -0,0 +1,61 @@
+/*
+ *  FILENAME:      generator.h
+ *
+ *  DESCRIPTION:
+ *      Deterministic terrain for chunks that were never saved, from fractal simplex noise
+ *
+ *  PUBLIC FUNCTIONS:
+ *      void        generate(game::vec2<int> chunkPos, Chunk::Data& data) const
+ *
+ *  NOTES:
+ *      The same seed, settings and tileset ids always give the same chunk, so a chunk can be thrown away and generated again.
+ *      Generates ground everywhere and rock where the height passes rockLevel. Rock cells get game layer id 1 (blocking).
+ *      generate() only reads the generator, many chunk threads use it at once.
+ *
+ */
+
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include <cstdint>
+
+#include "logic/chunk.h"
+#include "game/simplexnoise.h"
+
+class Generator
+{
+  public:
+    struct Settings
+    {
+      // in tiles
+      float featureSize = 48.f;
+      unsigned octaves = 5;
+      // height is in [-1, 1]
+      float rockLevel = .35f;
+      // ground tiles vary between index 1 and groundVariants
+      unsigned groundVariants = 4;
+    };
+
+    static constexpr char rockId = 1;
+
+    Generator(uint32_t seed, unsigned groundTileset, unsigned rockTileset);
+    Generator(uint32_t seed, unsigned groundTileset, unsigned rockTileset, const Settings& settings);
+
+    // overwrites game layer and tilesets, entities are left alone
+    void generate(game::vec2<int> chunkPos, Chunk::Data& data) const;
+
+    float height(float x, float y) const;
+
+    uint32_t getSeed() const;
+
+  private:
+    uint32_t m_Seed;
+    unsigned m_GroundTileset;
+    unsigned m_RockTileset;
+    Settings m_Settings;
+
+    // shuffled from the seed
+    SimplexNoise m_Noise;
+};
+
+#endif /* GENERATOR_H */
@@ -8,11 +8,14 @@
  *      void        addPlayer(SharedEntityPtr)
  *      void        removePlayer(SharedEntityPtr)
  *      void        tick()
+ *      void        autosave()
  *
  *  NOTES:
  *      When given a player the map allocates enough memory for containerLength*containerLength chunks; When a player is removed, its chunks will be as well.
  *      Most times not every chunk is used. For example, when two players are inside the same chunk. Then, both players will share the data.
  *        The unusued chunk is stored at m_unushedChunks meanwhile.
+ *      A damaged data.dat is moved to data.dat.damaged and getLoadResult() reports it, the map can't be continued without its seed
+ *        and entity count. Such a map writes nothing, callers are expected to report it and stop.
  *
  *  AUTHOR:         Leon Schierbach     DATE: 12.09.2018
  *
@@ -23,14 +26,19 @@
 
 #include "game/global.h"
 #include "logic/chunk.h"
+#include "logic/generator.h"
+#include "logic/generationcache.h"
+#include "logic/overview.h"
 #include "structs/tileset.h"
 #include "game/entity.h"
+#include "game/compression.h"
 
 #include <array>  //std::array
 #include <vector> //std::vector
 #include <map>    //std::map
 #include <stack>  //std::stack
 #include <mutex>
+#include <optional> //std::optional
 
 #include <memory> //std::shared_ptr
 
@@ -45,7 +53,7 @@ class Map
     struct ChunkLogicLock
     {
       SharedChunkPtr chunk;
-      bool isLogicLocked;
+      bool isLogicLocked = false;
       
       void lock()
       {
@@ -75,6 +83,15 @@ class Map
   public:
     using SharedEntityPtr = std::shared_ptr<Entity>;
     
+    enum class LoadResult
+    {
+      Loaded,
+      // no data.dat yet
+      Created,
+      // data.dat is damaged, now or on an earlier start, and waits as data.dat.damaged to be restored or removed
+      Damaged
+    };
+    
     static size_t getLoadingDistance();
 
     
@@ -144,33 +161,56 @@ class Map
     const std::string m_MapFolder = "data/map/";
     
     void init();
+    void createGenerator();
     
-    struct Data : public Saveable
+    struct Data
     {
       unsigned int m_EntityCount;
       // @todo: do this in a map, needs filesystem std::map-support
       std::vector<std::string> m_TileSetImgs;
-
-      
-      void write(std::ofstream& out) override
-      {
-        filesystem::writeStruct(out, m_EntityCount);
-        filesystem::writeRange(out, m_TileSetImgs);
-      }
+      // how chunk files are compressed, maps saved before it existed stay uncompressed
+      compression::Codec m_ChunkCodec = compression::Codec::None;
+      // terrain of chunks that were never saved, maps saved before it existed use seed 0
+      uint32_t m_Seed = 0;
       
-      void read(std::ifstream& in) override
+      template<typename Archive>
+      void serialize(Archive& ar)
       {
-        filesystem::readStruct(in, m_EntityCount);
-        filesystem::readRange(in, m_TileSetImgs);
+        ar(m_EntityCount, m_TileSetImgs);
+        
+        if (filesystem::atEnd(ar))
+        {
+          return;
+        }
+        ar(m_ChunkCodec);
+        
+        if (filesystem::atEnd(ar))
+        {
+          return;
+        }
+        ar(m_Seed);
       }
     };
     
     Data m_Data;
     
+    std::optional<Generator> m_Generator;
+    // about 2.5 KB per chunk
+    GenerationCache m_GenerationCache { 512 };
+    
+    // a camera zoomed out all the way sees up to 49 regions, see Renderer::overviewMaxRegions
+    Overview m_Overview { m_MapFolder + "overview/", 64 };
+    
     std::mutex m_DataMutex;
     
+    bool m_Flushed = false;
+    LoadResult m_LoadResult = LoadResult::Created;
+    
     void updateEntity(SharedEntityPtr entity, bool firstUpdate = false);
+    std::optional<int> firstGamelayerInLine(char id, int line, int from, int to, bool isRow);
     void tickChunks();
+    // every chunk in memory once, shared ones included
+    std::vector<Chunk*> loadedChunks();
     
     void print();
 
@@ -178,6 +218,10 @@ class Map
   public:
     Map();
     ~Map();
+    
+    LoadResult getLoadResult() const;
+    // relative to the working directory
+    std::string getDataFilePath() const;
     Map(const Map&)             = delete;
     Map(Map&&)                  = delete;
     Map& operator=(const Map&)  = delete;
@@ -187,17 +231,55 @@ class Map
     std::optional<ScopedChunkLock> getIdealChunk(game::vec2<int> pos);
     
     void tick();
+    
+    struct FlushResult
+    {
+      size_t chunks;
+      float seconds;
+    };
+    
+    // writes all chunks and the map data at once and waits for the last write. Meant for shutting down,
+    // neither the chunks nor the map save again when destroyed
+    FlushResult flush();
+    // starts a save of every loaded chunk and writes the map data and overview, chunks that only had entities change append to their delta log
+    void autosave();
 
     void addEntity(SharedEntityPtr entity);
     void removeEntity(SharedEntityPtr entity);
 
     unsigned int getNextEntityId();
     unsigned int addNewTileset(const std::string& imgName);
+    // id of the first tileset using imgName, added if there is none
+    unsigned int getTilesetId(const std::string& imgName);
     
     std::optional<std::string> getTilesetImgName(unsigned id);
     
+    // used from chunk threads, generate() is const
+    const Generator& getGenerator() const;
+    // generates through the generation cache, true if the chunk came from the cache
+    bool generateChunk(game::vec2<int> pos, Chunk::Data& data);
+    
+    // chunks draw themselves into it, zoomed out views read it
+    Overview& getOverview();
+    
+    uint32_t getSeed();
+    // only for maps without chunks yet, chunks generated with the old seed would not fit the new ones
+    void setSeed(uint32_t seed);
+    
+    compression::Codec getChunkCodec();
+    // applies to chunks saved from now on, loading detects the codec of each file
+    void setChunkCodec(compression::Codec codec);
+    
     char getGamelayerIdAt(game::vec2<float> pos);
     
+    // game layer queries work on whole chunks of bits, unloaded chunks count as empty
+    bool anyGamelayerInBox(char id, game::vec2<float> boxTopLeft, game::vec2<float> size);
+    // first cell (world cell coordinate) with the id walking from 'from' to 'to' along a row/column, both ends included
+    std::optional<int> firstGamelayerInRow(char id, int row, int fromX, int toX);
+    std::optional<int> firstGamelayerInColumn(char id, int column, int fromY, int toY);
+    // for combining masks of several ids, e.g. everything that blocks a path
+    std::optional<Chunk::cellMask> getGamelayerMask(game::vec2<int> chunkPos, char id);
+    
     template<typename EntityType>
     auto get_entity_at(game::vec2<float> pos) -> EntityType*;
     
@@ -0,0 +1,129 @@
+/*
+ *  FILENAME:      overview.h
+ *
+ *  DESCRIPTION:
+ *      Downsampled pyramid of the map's tiles for zoomed out views, one per region of regionChunks x regionChunks chunks
+ *
+ *  PUBLIC FUNCTIONS:
+ *      void        update(game::vec2<int> chunkPos, const Chunk::Data& data)
+ *      bool        has(game::vec2<int> chunkPos)
+ *      bool        getLevel(game::vec2<int> region, unsigned level, std::vector<Texel>& texels, uint32_t& revision)
+ *      void        save()
+ *
+ *  NOTES:
+ *      Level 1 has one texel per tile, every further level one per levelFactor x levelFactor texels of the level before.
+ *      A texel names the topmost tile (tileset id and index) instead of a colour, so the logic doesn't need the tileset images.
+ *      Downsampling keeps the most common tile of a block, the renderer turns tiles into colours when uploading.
+ *      Regions live in "<x>.<y>.odat" in the overview folder. Only level 1 is saved, the others are rebuilt on load.
+ *      Chunks update their region whenever their tiles are saved, loaded or generated, see Chunk. Changes are written by save().
+ *
+ */
+
+#ifndef OVERVIEW_H
+#define OVERVIEW_H
+
+#include <array>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "logic/chunk.h"
+#include "game/compression.h"
+
+class Overview
+{
+  public:
+    // 0: nothing, else (tileset id + 1) << 8 | tile index
+    using Texel = uint32_t;
+
+    static constexpr int regionChunks = 16;
+    static constexpr unsigned regionTiles = regionChunks * game::math::chunkSize;
+    static constexpr unsigned levelFactor = 4;
+    // level 3 has one texel per chunk
+    static constexpr unsigned levelCount = 3;
+
+    static Texel encode(unsigned tilesetId, char index);
+    static unsigned tilesetId(Texel texel);
+    static unsigned char tileIndex(Texel texel);
+
+    // texels per side of a region at level (1..levelCount)
+    static unsigned levelSize(unsigned level);
+    static game::vec2<int> chunkToRegion(game::vec2<int> chunkPos);
+
+    // capacity in regions, about 280 KB each
+    Overview(const std::string& folder, size_t capacity);
+    Overview(const Overview&)            = delete;
+    Overview& operator=(const Overview&) = delete;
+
+    // redraws the chunk's part of every level
+    void update(game::vec2<int> chunkPos, const Chunk::Data& data);
+    // whether the chunk was drawn into its region before
+    bool has(game::vec2<int> chunkPos);
+
+    // copy of one level, false if nothing of the region was drawn yet. revision changes with every update of the region
+    bool getLevel(game::vec2<int> region, unsigned level, std::vector<Texel>& texels, uint32_t& revision);
+    // revision without copying or loading, stays the same while the region is evicted. 0 if it wasn't loaded yet
+    uint32_t getRevision(game::vec2<int> region);
+    bool isCached(game::vec2<int> region);
+
+    // writes changed regions
+    void save();
+    void setCodec(compression::Codec codec);
+
+  private:
+    using PresentMask = std::array<uint64_t, regionChunks * regionChunks / 64>;
+
+    struct Region
+    {
+      game::vec2<int> pos;
+      // bit per chunk drawn, row by row
+      PresentMask present { };
+      std::vector<std::vector<Texel>> levels;
+      uint32_t revision = 0;
+      bool dirty = false;
+    };
+
+    struct Data
+    {
+      PresentMask m_Present { };
+      std::vector<Texel> m_Texels;
+
+      static constexpr char magic[4] = { 'B', 'O', 'V', 'W' };
+      static constexpr uint16_t version = 1;
+
+      template<typename Archive>
+      void serialize(Archive& ar)
+      {
+        filesystem::versionTag(ar, magic, version);
+        ar(m_Present, m_Texels);
+      }
+    };
+
+    struct KeyHash
+    {
+      size_t operator()(const game::vec2<int>& pos) const;
+    };
+
+    std::string m_Folder;
+    size_t m_Capacity;
+    compression::Codec m_Codec = compression::Codec::LZ4;
+
+    // most recently used in front
+    std::list<Region> m_Regions;
+    std::unordered_map<game::vec2<int>, std::list<Region>::iterator, KeyHash> m_Index;
+    std::mutex m_Mutex;
+    uint32_t m_NextRevision = 1;
+    // of every region loaded since start, evicted ones included. A few bytes per region of regionTiles x regionTiles tiles
+    std::unordered_map<game::vec2<int>, uint32_t, KeyHash> m_Revisions;
+
+    std::string filePath(game::vec2<int> region) const;
+    // loads the region if needed, evicting (and writing) the least recently used one
+    Region& region(game::vec2<int> pos);
+    void write(Region& region);
+    static void downsample(Region& region, unsigned level, unsigned firstX, unsigned firstY, unsigned size);
+};
+
+#endif /* OVERVIEW_H */
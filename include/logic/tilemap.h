@@ -0,0 +1,48 @@
+/*
+ *  FILENAME:      tilemap.h
+ *
+ *  DESCRIPTION:
+ *      Encoding of a tileset's tileData into a small index texture and a CPU reference of the lookup done in tile.fs.glsl
+ *
+ *  NOTES:
+ *      Every texel is RGBA8: r = tile index, g = rotation in quarter turns, b/a unused.
+ *      atlasCoord must stay in sync with tilemapCoord() in data/shader/tile.fs.glsl, perTileAtlasCoord mirrors Camera::renderTileset.
+ *      Both draw the same, "blub_bench -s tilemap" compares them for every tile index and rotation.
+ *      Nothing here needs SDL, so it is part of blub_core.
+ *
+ */
+
+#ifndef TILEMAP_H
+#define TILEMAP_H
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "structs/tileset.h"
+#include "game/vector.hpp"
+
+namespace tilemap
+{
+  // tiles per row/column of a tileset image
+  static constexpr unsigned atlasCells = 16;
+
+  struct IndexMap
+  {
+    unsigned w = 0;
+    unsigned h = 0;
+    std::vector<uint8_t> texels;
+
+    uint64_t hash() const;
+  };
+
+  void encode(const Tileset& ts, IndexMap& map);
+
+  // normalized atlas coordinate sampled at uv (0..1 over the whole tileset), empty if the tile is transparent
+  std::optional<game::vec2<float>> atlasCoord(const IndexMap& map, game::vec2<float> uv);
+
+  // same lookup as done by blitting single tiles, each turned about its center
+  std::optional<game::vec2<float>> perTileAtlasCoord(const Tileset& ts, game::vec2<float> uv);
+}
+
+#endif /* TILEMAP_H */
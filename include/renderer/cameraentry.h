@@ -1,6 +1,8 @@
 #ifndef CAMERAENTRY_H
 #define CAMERAENTRY_H
 
+#include <vector>
+
 #include "logic/map.h"
 
 struct CameraEntry
@@ -8,6 +10,13 @@ struct CameraEntry
   Map::SharedEntityPtr camera;
   std::array<float,4> data;
   size_t id;
+
+  // chunks in view, rebuilt by Renderer::updateVisibleChunks only when the first or last of them changes
+  std::vector<vec2<int>> visibleChunks;
+  vec2<int> visibleFirst {1, 1};
+  vec2<int> visibleLast {0, 0};
+
+  CameraEntry(Map::SharedEntityPtr camera, std::array<float,4> data, size_t id) : camera(camera), data(data), id(id) {}
 };
 
 #endif /* CAMERAENTRY_H */
@@ -1,72 +1,151 @@
 #ifndef LODIMAGE_HPP
 #define LODIMAGE_HPP
 
+#include <algorithm>
 #include <string>
+#include <vector>
 #include "SDL_gpu.h"
 
 #include "game/entities/camera.h"
 #include "game/gamemath.hpp"
+#include "renderer/mipchain.h"
 
 class LODImage {
   private:
     std::vector<GPU_Image*> images;
 
+    // average RGBA8 of every tile of the atlas, for drawing tiles as single pixels (see Overview)
+    std::vector<uint8_t> cellColors;
+
     // save last request's data for fast repeated acces
     float lastUnit = -1.f;
     size_t lastIndex = 0;
 
-  public:
-    LODImage(const std::string* paths, size_t  numImages, unsigned int minWidth) {
-      // initial images
-      GPU_Image* img = NULL;
-      for(size_t i=0; i<numImages; i++){
-        img = GPU_LoadImage(paths[i].c_str());
-        GPU_SetImageFilter(img, GPU_FILTER_NEAREST);
-        images.push_back(img);
+    static bool loadLevel(const std::string& path, mipchain::Level& level) {
+      SDL_Surface* loaded = GPU_LoadSurface(path.c_str());
+      if(loaded == NULL) {
+        return false;
       }
 
-      for(size_t i=numImages-1; img->w/2 >= minWidth; i++) {
-        // create next smaller image
-        img = GPU_CreateImage(img->w/2, img->h/2, GPU_FORMAT_RGBA);
-        GPU_SetImageFilter(img, GPU_FILTER_NEAREST);
-
-        // render old image to new
-        GPU_LoadTarget(img);
-        GPU_ClearColor(img->target, {0,0,0,0});
-        GPU_BlitScale(images[i], NULL, img->target, img->w/2, img->h/2, 0.5f, 0.5f);
+      // normalize whatever the file contained to tightly packed RGBA8
+      SDL_Surface* rgba = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0);
+      SDL_FreeSurface(loaded);
+      if(rgba == NULL) {
+        return false;
+      }
 
-        // add to other images
-        images.push_back(img);
+      level.w = rgba->w;
+      level.h = rgba->h;
+      level.pixels.resize(static_cast<size_t>(level.w) * level.h * 4);
+      for(unsigned y=0; y<level.h; y++) {
+        const auto* row = static_cast<const uint8_t*>(rgba->pixels) + static_cast<size_t>(y) * rgba->pitch;
+        std::copy(row, row + level.w * 4, &level.pixels[static_cast<size_t>(y) * level.w * 4]);
       }
+      SDL_FreeSurface(rgba);
+
+      return true;
     }
 
-    LODImage(const char* path, unsigned int minWidth) {
-      // initial image
-      GPU_Image* img = GPU_LoadImage(path);
-      GPU_SetImageFilter(img, GPU_FILTER_NEAREST);
-      images.push_back(img);
+    // alpha weighted, fully transparent tiles stay transparent
+    static std::vector<uint8_t> averageCells(const mipchain::Level& level) {
+      constexpr unsigned cells = 16;
+      std::vector<uint8_t> colors(cells * cells * 4, 0);
+      unsigned cellW = level.w / cells;
+      unsigned cellH = level.h / cells;
+      if(cellW == 0 || cellH == 0) {
+        return colors;
+      }
 
-      for(size_t i=0; img->w/2 >= minWidth; i++) {
-        // create next smaller image
-        img = GPU_CreateImage(img->w/2, img->h/2, GPU_FORMAT_RGBA);
+      for(unsigned cell=0; cell<cells*cells; cell++) {
+        uint64_t sum[4] = {0, 0, 0, 0};
+        for(unsigned y=(cell/cells)*cellH; y<(cell/cells+1)*cellH; y++) {
+          for(unsigned x=(cell%cells)*cellW; x<(cell%cells+1)*cellW; x++) {
+            const auto* pixel = &level.pixels[(static_cast<size_t>(y) * level.w + x) * 4];
+            for(unsigned c=0; c<3; c++) {
+              sum[c] += pixel[c] * pixel[3];
+            }
+            sum[3] += pixel[3];
+          }
+        }
+        if(sum[3] > 0) {
+          for(unsigned c=0; c<3; c++) {
+            colors[cell*4 + c] = static_cast<uint8_t>(sum[c] / sum[3]);
+          }
+          colors[cell*4 + 3] = static_cast<uint8_t>(sum[3] / (cellW * cellH));
+        }
+      }
+      return colors;
+    }
+
+    static GPU_Image* upload(const mipchain::Level& level) {
+      GPU_Image* img = GPU_CreateImage(level.w, level.h, GPU_FORMAT_RGBA);
+      if(img != NULL) {
+        GPU_UpdateImageBytes(img, NULL, level.pixels.data(), level.w * 4);
         GPU_SetImageFilter(img, GPU_FILTER_NEAREST);
+      }
+      return img;
+    }
 
-        // render old image to new
-        GPU_LoadTarget(img);
-        GPU_ClearColor(img->target, {0,0,0,0});
-        GPU_BlitScale(images[i], NULL, img->target, img->w/2, img->h/2, 0.5f, 0.5f);
+    // loads path and all smaller levels down to minWidth, from cacheDir if possible
+    void appendChain(const std::string& path, unsigned int minWidth, const std::string& cacheDir) {
+      mipchain::Chain chain;
+      std::string cacheFile = cacheDir.empty() ? "" : mipchain::cachePath(cacheDir, path);
+
+      if(cacheFile.empty() || !mipchain::loadCache(cacheFile, path, minWidth, chain)) {
+        chain.resize(1);
+        if(!loadLevel(path, chain[0])) {
+          return;
+        }
+        mipchain::extend(chain, minWidth);
+
+        if(!cacheFile.empty()) {
+          mipchain::saveCache(cacheFile, path, minWidth, chain);
+        }
+      }
 
-        // add to other images
-        images.push_back(img);
+      // the smallest level is already averaged the most
+      if(!chain.empty()) {
+        cellColors = averageCells(chain.back());
+      }
+
+      for(const auto& level: chain) {
+        GPU_Image* img = upload(level);
+        if(img != NULL) {
+          images.push_back(img);
+        }
+      }
+    }
+
+  public:
+    // paths are ordered from biggest to smallest, levels below the last one are generated
+    LODImage(const std::string* paths, size_t numImages, unsigned int minWidth, const std::string& cacheDir = "") {
+      // initial images
+      for(size_t i=0; i+1<numImages; i++){
+        GPU_Image* img = GPU_LoadImage(paths[i].c_str());
+        if(img != NULL) {
+          GPU_SetImageFilter(img, GPU_FILTER_NEAREST);
+          images.push_back(img);
+        }
+      }
+
+      if(numImages > 0) {
+        appendChain(paths[numImages-1], minWidth, cacheDir);
       }
     }
 
+    LODImage(const char* path, unsigned int minWidth, const std::string& cacheDir = "") {
+      appendChain(path, minWidth, cacheDir);
+    }
+
     GPU_Image* bestImage(Camera* camera) {
+      if(images.empty()) {
+        return NULL;
+      }
+
       // already requested last time?
       if (camera != nullptr)
       {
         if(camera->pixelsInUnit() == lastUnit) {
-          lastUnit = camera->pixelsInUnit();
           return images[lastIndex];
         }
         // if not, update for next time
@@ -74,17 +153,32 @@ class LODImage {
 
         float optimalW = camera->pixelsInUnit()*16.f*game::math::tileWidth;
 
-        for(size_t i=images.size(); i>0; --i) {
-          if(images[i-1]->w >= optimalW) {
-            // keep track of index for next time
-            lastIndex = i-1;
-            return images[i-1];
-          }
+        // levels halve each step, so log2 of the width ratio gives the index directly
+        size_t i = mipchain::levelForWidth(images[0]->w, images.size(), optimalW);
+
+        // hand made levels don't have to be exact halves, correct by walking to the neighbours
+        while(i > 0 && images[i]->w < optimalW) {
+          --i;
         }
+        while(i+1 < images.size() && images[i+1]->w >= optimalW) {
+          ++i;
+        }
+
+        // keep track of index for next time
+        lastIndex = i;
+        return images[i];
       }
-      // if nothing is found, return default first image
+      // if no camera is given, return default first image
       return images[0];
     }
+
+    // RGBA8 of the tile at index, NULL if the image didn't load
+    const uint8_t* cellColor(unsigned char index) const {
+      if(cellColors.empty()) {
+        return NULL;
+      }
+      return &cellColors[index * 4];
+    }
 };
 
-#endif /* LODIMAGE_HPP */
\ No newline at end of file
+#endif /* LODIMAGE_HPP */
@@ -0,0 +1,62 @@
+/*
+ *  FILENAME:      minimap.h
+ *
+ *  DESCRIPTION:
+ *      Overlay showing the chunks around a point at one texel per tile
+ *
+ *  NOTES:
+ *      Texels come from the first tileset of a chunk (the average colour of the tile, see LODImage::cellColor),
+ *      cells with a game layer id are drawn darker. Chunks that aren't loaded stay transparent.
+ *      The pixels live on the CPU. A chunk is only redrawn when its revision changed (see Chunk::touch) or another chunk
+ *      took its slot, and each update uploads the rectangle around the redrawn chunks in one call.
+ *      Off by default, the controller toggles it with M.
+ *
+ */
+
+#ifndef MINIMAP_H
+#define MINIMAP_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "SDL_gpu.h"
+
+#include "logic/map.h"
+#include "renderer/lodimage.hpp"
+#include "renderer/overlay.h"
+
+class Minimap
+{
+  private:
+    Map* map;
+    std::map<std::string, LODImage>* tilesetImgs;
+
+    // chunks shown around the center chunk in every direction, the map only hands out the inner ring of what it loads
+    int radius;
+    // texels per side
+    unsigned size;
+
+    GPU_Image* image;
+    Overlay overlay;
+    std::vector<uint8_t> pixels;
+
+    // chunk revision each slot shows, row by row. 0: nothing drawn yet
+    std::vector<uint64_t> slotRevisions;
+    vec2<int> center;
+
+    void drawChunk(const Chunk* chunk, int slotX, int slotY);
+
+  public:
+    Minimap(Map* map, std::map<std::string, LODImage>* tilesetImgs, int radius = 1);
+    ~Minimap();
+    Minimap(const Minimap&)            = delete;
+    Minimap& operator=(const Minimap&) = delete;
+
+    // redraws the chunks that changed, centered on the chunk of worldCenter
+    void update(vec2<float> worldCenter);
+
+    Overlay* getOverlay();
+};
+
+#endif /* MINIMAP_H */
@@ -0,0 +1,46 @@
+/*
+ *  FILENAME:      mipchain.h
+ *
+ *  DESCRIPTION:
+ *      CPU side generation of LOD levels (2x2 box filter) and a disk cache for generated chains
+ *
+ *  NOTES:
+ *      All levels are tightly packed RGBA8. The box filter uses SSE2 when available and falls back to scalar code.
+ *      A cached chain is only accepted if size and modification time of its source file still match.
+ *
+ */
+
+#ifndef MIPCHAIN_H
+#define MIPCHAIN_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace mipchain
+{
+  struct Level
+  {
+    unsigned w = 0;
+    unsigned h = 0;
+    std::vector<uint8_t> pixels;
+  };
+
+  using Chain = std::vector<Level>;
+
+  // halves both dimensions, averaging each 2x2 block
+  Level downsample(const Level& src);
+
+  // appends halved levels to chain until the next level would be narrower than minWidth
+  void extend(Chain& chain, unsigned minWidth);
+
+  // index of the smallest level still at least optimalWidth wide, assuming every level halves the previous one
+  size_t levelForWidth(unsigned baseWidth, size_t levelCount, float optimalWidth);
+
+  std::string cachePath(const std::string& cacheDir, const std::string& sourcePath);
+
+  bool loadCache(const std::string& cacheFile, const std::string& sourcePath, unsigned minWidth, Chain& chain);
+  void saveCache(const std::string& cacheFile, const std::string& sourcePath, unsigned minWidth, const Chain& chain);
+}
+
+#endif /* MIPCHAIN_H */
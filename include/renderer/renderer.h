@@ -23,7 +23,9 @@
 #endif
 
 #include <map>
+#include <memory>
 #include <string>
+#include <tuple>
 #include <vector>
 
 #include "SDL_gpu.h"
@@ -33,16 +35,79 @@
 #include "renderer/cameraentry.h"
 #include "renderer/lodimage.hpp"
 #include "renderer/coloredrect.h"
+#include "renderer/minimap.h"
+#include "logic/tilemap.h"
 
 class Renderer
 {
   private:
 
     static constexpr char tilesetDirectory[] = "data/img/tileset/";
+    static constexpr char lodCacheDirectory[] = "data/cache/lod/";
     std::map<std::string, LODImage> tilesetImgs;
     std::map<std::string, LODImage> tilesetNormals;
 
+    // index textures of tilesets for tilemap mode, keyed by chunk position and tileset id
+    struct TilemapEntry
+    {
+      GPU_Image* image;
+      uint64_t hash;
+      uint32_t lastUsed;
+    };
+    using TilemapKey = std::tuple<int, int, unsigned>;
+    static constexpr uint32_t tilemapKeepTicks = 120;
+
+    bool tilemapMode;
+    std::map<TilemapKey, TilemapEntry> tilemaps;
+    tilemap::IndexMap tilemapScratch;
+
+    // colour textures of Overview levels, keyed by region position and level
+    struct OverviewEntry
+    {
+      GPU_Image* image;
+      uint32_t revision;
+      uint32_t lastUsed;
+    };
+    using OverviewKey = std::tuple<int, int, unsigned>;
+    // cameras showing less than this many pixels per tile draw the overview instead of chunks
+    static constexpr float overviewTilePixels = 2.f;
+    // regions read from disk per frame, the rest shows up in the next frames
+    static constexpr unsigned overviewLoadsPerFrame = 4;
+    // cameras can't zoom out further than this many regions along their longer side, so a view touches at most
+    // (overviewMaxRegions + 1)^2 regions and they all fit into the overview's cache (see Map)
+    static constexpr float overviewMaxRegions = 6.f;
+
+    std::map<OverviewKey, OverviewEntry> overviews;
+    std::vector<Overview::Texel> overviewScratch;
+    std::vector<uint8_t> overviewPixels;
+    unsigned overviewLoads;
+
     std::vector<CameraEntry> cameras;
+
+    // what all cameras need this frame, gathered once in prepareFrame with every chunk locked once.
+    // Cameras only differ in their view transform when drawing it
+    struct PreparedLayer
+    {
+      // copy, the chunk is unlocked again after preparing
+      Tileset tileset;
+      vec2<int> chunkPos;
+      // the global tileset belongs to no chunk and is drawn by every camera
+      bool global;
+      LODImage* image;
+      LODImage* normals;
+      // tilemap mode only
+      GPU_Image* indexMap;
+      float x_offset;
+      float y_offset;
+    };
+    // chunks seen by any camera, sorted. Rebuilt only when a camera's visible chunks change
+    std::vector<vec2<int>> visibleUnion;
+    std::vector<PreparedLayer> preparedLayers;
+    std::vector<Entity> preparedEntities;
+    // image and normal map by tileset id, resolved once per frame
+    std::map<unsigned, std::pair<LODImage*, LODImage*>> resolvedImages;
+    // by camera id
+    std::map<size_t, std::unique_ptr<Minimap>> minimaps;
     std::vector<ColoredRect> boxQueue;
 
     GPU_Target* renderTarget;
@@ -53,8 +118,20 @@ class Renderer
     void resizeCameras();
     void renderCamera(CameraEntry& camera);
     void renderCameraEntities(CameraEntry& camera);
+    void prepareFrame();
+    void prepareLayer(const Tileset& ts, const TilemapKey& key, bool global, float x_offset, float y_offset);
+    void renderTilesetLayer(Camera* cam, const PreparedLayer& layer);
+    GPU_Image* getTilemapImage(const TilemapKey& key, const Tileset& ts);
+    void releaseTilemaps();
+    bool useOverview(const Camera* cam) const;
+    float clampScale(const Camera* cam, float scale) const;
+    void renderOverview(Camera* cam);
+    GPU_Image* getOverviewImage(const OverviewKey& key);
+    void releaseOverviews();
     size_t getCameraId() const;
-    bool chunkInBounds(const Chunk& chunk, const CameraEntry& camera);
+    bool chunkInBounds(vec2<int> chunkPos, const CameraEntry& camera);
+    bool updateVisibleChunks(CameraEntry& camera);
+    bool chunkVisible(vec2<int> chunkPos, const CameraEntry& camera) const;
     void drawBoxes();
 
     GPU_Image* LoadImageWithMipmaps(const char* filename);
@@ -99,6 +176,8 @@ class Renderer
     void clearOverlays(size_t cameraId);
 
     void setGlobalTileset(Tileset* ts);
+    void setTilemapMode(bool enabled);
+    void setMinimap(size_t cameraId, bool enabled);
 
     void renderBox(float x, float y, float w, float h, SDL_Color borderColor = {0,0,255,255}, SDL_Color areaColor = {0,0,0,0}, float borderRadius = 0.f);
     void renderBox2(float x, float y, float x2, float y2, SDL_Color borderColor = {0,0,255,255}, SDL_Color areaColor = {0,0,0,0}, float borderRadius = 0.f);
@@ -108,7 +187,8 @@ class Renderer
     vec2<float> pixelToXYAuto(vec2<float> pixel);
     vec2<float> worldToPixel(size_t cameraIndex, vec2<float> worldPos);
     
-    CameraEntry getCamera(size_t index);
+    CameraEntry& getCamera(size_t index);
+    std::vector<vec2<float>> getCameraPositions() const;
     
     GPU_Image* getTilesetImage(const std::string& imgName);
     std::map<std::string, LODImage>* getTilesetImgs();
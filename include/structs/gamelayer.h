@@ -0,0 +1,304 @@
+/*
+ *  FILENAME:      gamelayer.h
+ *
+ *  DESCRIPTION:
+ *      Bit-packed game layer (collision ids) of a chunk and the one-bit-per-cell masks it is queried with
+ *
+ *  PUBLIC FUNCTIONS:
+ *      CellMask    CellMask::rect(int x, int y, int w, int h)
+ *      uint64_t    CellMask::row(unsigned y)
+ *      uint64_t    CellMask::column(unsigned x)
+ *      char        GameLayer::get(unsigned x, unsigned y)
+ *      void        GameLayer::set(unsigned x, unsigned y, char id)
+ *      CellMask    GameLayer::mask(char id)
+ *
+ *  NOTES:
+ *      Cells are numbered row-major and a row never crosses a 64 bit word, so rectangles and row scans work on whole words.
+ *      GameLayer keeps the ids as 8 bit planes (plane i holds bit i of every cell's id), the mask of one id combines
+ *      all planes. That is exact for every id and stays as small as the char array it replaces.
+ *      Saved as that char array (x-major), so chunk files keep their layout.
+ *
+ */
+
+#ifndef GAMELAYER_H
+#define GAMELAYER_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+#include "game/filesystem.hpp"
+
+template<unsigned Size>
+class CellMask
+{
+  static_assert(Size <= 64 && 64 % Size == 0, "a row has to fit into one word");
+
+  public:
+    static constexpr unsigned size        = Size;
+    static constexpr unsigned cellCount   = Size * Size;
+    static constexpr unsigned wordCount   = (cellCount + 63) / 64;
+    static constexpr unsigned rowsPerWord = 64 / Size;
+
+  private:
+    std::array<uint64_t, wordCount> m_Words { };
+
+    // bits first..last of a row
+    static uint64_t span(unsigned first, unsigned last)
+    {
+      auto width = last - first + 1;
+      return (width == 64 ? ~uint64_t(0) : (uint64_t(1) << width) - 1) << first;
+    }
+
+    static constexpr uint64_t rowMask()
+    {
+      return Size == 64 ? ~uint64_t(0) : (uint64_t(1) << Size) - 1;
+    }
+
+    void clampLastWord()
+    {
+      if (cellCount % 64 != 0)
+      {
+        m_Words[wordCount - 1] &= (uint64_t(1) << (cellCount % 64)) - 1;
+      }
+    }
+
+  public:
+    // cells of the rectangle, clipped to the mask
+    static CellMask rect(int x, int y, int w, int h)
+    {
+      CellMask result;
+
+      int firstX = std::max(x, 0);
+      int lastX  = std::min(x + w, static_cast<int>(Size)) - 1;
+      int firstY = std::max(y, 0);
+      int lastY  = std::min(y + h, static_cast<int>(Size)) - 1;
+
+      if (firstX > lastX || firstY > lastY)
+      {
+        return result;
+      }
+
+      auto bits = span(firstX, lastX);
+      for (auto row = firstY; row <= lastY; row++)
+      {
+        result.m_Words[row / rowsPerWord] |= bits << ((row % rowsPerWord) * Size);
+      }
+      return result;
+    }
+
+    static CellMask full()
+    {
+      CellMask result;
+      result.m_Words.fill(~uint64_t(0));
+      result.clampLastWord();
+      return result;
+    }
+
+    bool test(unsigned x, unsigned y) const
+    {
+      auto cell = y * Size + x;
+      return (m_Words[cell / 64] >> (cell % 64)) & 1u;
+    }
+
+    void set(unsigned x, unsigned y, bool value = true)
+    {
+      auto cell = y * Size + x;
+      auto bit = uint64_t(1) << (cell % 64);
+      if (value)
+      {
+        m_Words[cell / 64] |= bit;
+      }
+      else
+      {
+        m_Words[cell / 64] &= ~bit;
+      }
+    }
+
+    // bit x is cell (x, y)
+    uint64_t row(unsigned y) const
+    {
+      return (m_Words[y / rowsPerWord] >> ((y % rowsPerWord) * Size)) & rowMask();
+    }
+
+    // bit y is cell (x, y)
+    uint64_t column(unsigned x) const
+    {
+      uint64_t result = 0;
+      for (auto y = 0u; y < Size; y++)
+      {
+        result |= ((m_Words[y / rowsPerWord] >> ((y % rowsPerWord) * Size + x)) & 1u) << y;
+      }
+      return result;
+    }
+
+    bool any() const
+    {
+      return std::any_of(m_Words.begin(), m_Words.end(), [](uint64_t word) { return word != 0; });
+    }
+
+    size_t count() const
+    {
+      size_t result = 0;
+      for (auto word : m_Words)
+      {
+        result += static_cast<size_t>(__builtin_popcountll(word));
+      }
+      return result;
+    }
+
+    bool intersects(const CellMask& other) const
+    {
+      for (auto i = 0u; i < wordCount; i++)
+      {
+        if ((m_Words[i] & other.m_Words[i]) != 0)
+        {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    CellMask& operator&=(const CellMask& other)
+    {
+      for (auto i = 0u; i < wordCount; i++)
+      {
+        m_Words[i] &= other.m_Words[i];
+      }
+      return *this;
+    }
+
+    CellMask& operator|=(const CellMask& other)
+    {
+      for (auto i = 0u; i < wordCount; i++)
+      {
+        m_Words[i] |= other.m_Words[i];
+      }
+      return *this;
+    }
+
+    CellMask operator&(const CellMask& other) const
+    {
+      return CellMask(*this) &= other;
+    }
+
+    CellMask operator|(const CellMask& other) const
+    {
+      return CellMask(*this) |= other;
+    }
+
+    CellMask operator~() const
+    {
+      CellMask result;
+      for (auto i = 0u; i < wordCount; i++)
+      {
+        result.m_Words[i] = ~m_Words[i];
+      }
+      result.clampLastWord();
+      return result;
+    }
+
+    bool operator==(const CellMask& other) const
+    {
+      return m_Words == other.m_Words;
+    }
+
+    bool operator!=(const CellMask& other) const
+    {
+      return m_Words != other.m_Words;
+    }
+};
+
+template<unsigned Size>
+class GameLayer
+{
+  public:
+    static constexpr unsigned size       = Size;
+    static constexpr unsigned planeCount = 8;
+
+  private:
+    std::array<CellMask<Size>, planeCount> m_Planes { };
+
+  public:
+    char get(unsigned x, unsigned y) const
+    {
+      if (x >= Size || y >= Size)
+      {
+        return 0;
+      }
+
+      unsigned id = 0;
+      for (auto plane = 0u; plane < planeCount; plane++)
+      {
+        id |= static_cast<unsigned>(m_Planes[plane].test(x, y)) << plane;
+      }
+      return static_cast<char>(id);
+    }
+
+    void set(unsigned x, unsigned y, char id)
+    {
+      if (x >= Size || y >= Size)
+      {
+        return;
+      }
+
+      for (auto plane = 0u; plane < planeCount; plane++)
+      {
+        m_Planes[plane].set(x, y, (static_cast<unsigned char>(id) >> plane) & 1u);
+      }
+    }
+
+    // cells with exactly this id
+    CellMask<Size> mask(char id) const
+    {
+      auto result = CellMask<Size>::full();
+      for (auto plane = 0u; plane < planeCount; plane++)
+      {
+        result &= (static_cast<unsigned char>(id) >> plane) & 1u ? m_Planes[plane] : ~m_Planes[plane];
+      }
+      return result;
+    }
+
+    // cells with any id but 0
+    CellMask<Size> occupied() const
+    {
+      CellMask<Size> result;
+      for (const auto& plane : m_Planes)
+      {
+        result |= plane;
+      }
+      return result;
+    }
+
+    template<typename Archive>
+    void serialize(Archive& ar)
+    {
+      std::array<std::array<char, Size>, Size> cells { };
+
+      if constexpr (Archive::isWriting)
+      {
+        for (auto x = 0u; x < Size; x++)
+        {
+          for (auto y = 0u; y < Size; y++)
+          {
+            cells[x][y] = get(x, y);
+          }
+        }
+      }
+
+      ar(cells);
+
+      if constexpr (!Archive::isWriting)
+      {
+        for (auto x = 0u; x < Size; x++)
+        {
+          for (auto y = 0u; y < Size; y++)
+          {
+            set(x, y, cells[x][y]);
+          }
+        }
+      }
+    }
+};
+
+#endif /* GAMELAYER_H */
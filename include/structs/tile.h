@@ -1,33 +1,50 @@
 #ifndef TILE_H
 #define TILE_H
 
-#include "game/saveable.h"
+#include <cmath>
+#include <cstdint>
+
 #include "game/filesystem.hpp"
 
-struct Tile : public Saveable
+// 4 bytes: index into the tileset image and its rotation in clockwise quarter turns
+struct Tile
 {
-  char index;
-  float rot;
-  
+  char index = 0;
+  uint8_t turns = 0;
+  uint16_t reserved = 0;
+
   Tile (char index, float rot)
   {
     this->index = index;
-    this->rot = rot;
+    this->turns = quarterTurns(rot);
   }
-  
-  Tile() {}
-  
-  void write(std::ofstream& out) override
+
+  Tile() = default;
+
+  static uint8_t quarterTurns(float rot)
   {
-    filesystem::writeStruct(out, index);
-    filesystem::writeStruct(out, rot);
+    return static_cast<uint8_t>(static_cast<long>(std::lround(rot / 90.f)) & 3);
   }
 
-  void read(std::ifstream& in) override
+  float rot() const
   {
-    filesystem::readStruct(in, index);
-    filesystem::readStruct(in, rot);
+    return turns * 90.f;
+  }
+
+  // files keep the rotation as float degrees
+  template<typename Archive>
+  void serialize(Archive& ar)
+  {
+    float degrees = rot();
+    ar(index, degrees);
+
+    if constexpr (!Archive::isWriting)
+    {
+      turns = quarterTurns(degrees);
+    }
   }
 };
 
-#endif /* TILE_H */
\ No newline at end of file
+static_assert(sizeof(Tile) == 4, "Tile is stored packed in TileGrid");
+
+#endif /* TILE_H */
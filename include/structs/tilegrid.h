@@ -0,0 +1,209 @@
+/*
+ *  FILENAME:      tilegrid.h
+ *
+ *  DESCRIPTION:
+ *      Fixed Size x Size grid of tiles in one contiguous row-major array, plus a bitmask of the occupied cells
+ *
+ *  PUBLIC FUNCTIONS:
+ *      Tile        get(unsigned x, unsigned y)
+ *      void        set(unsigned x, unsigned y, Tile tile)
+ *      void        copy(const TileGrid<SrcSize>& src, int dstX, int dstY, unsigned w, unsigned h)
+ *      void        for_each(Lambda&& lam)
+ *
+ *  NOTES:
+ *      Index 0 is an empty cell (nothing gets drawn there). The mask and count only exist so empty cells and grids can be skipped quickly,
+ *      set() and copy() keep them in sync with the tiles.
+ *      Saved sparse as mask + occupied tiles in row-major order, file version 0 stored the whole grid as nested vectors.
+ *
+ */
+
+#ifndef TILEGRID_H
+#define TILEGRID_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "structs/tile.h"
+#include "game/filesystem.hpp"
+
+template<unsigned Size>
+class TileGrid
+{
+  public:
+    static constexpr unsigned size      = Size;
+    static constexpr unsigned cellCount = Size * Size;
+    static constexpr unsigned wordCount = (cellCount + 63) / 64;
+
+  private:
+    std::array<Tile, cellCount> m_Tiles { };
+    std::array<uint64_t, wordCount> m_Occupied { };
+    unsigned m_Count = 0;
+
+    void mark(unsigned cell, bool occupied)
+    {
+      auto bit = uint64_t(1) << (cell % 64);
+      m_Count += static_cast<unsigned>(occupied) - static_cast<unsigned>((m_Occupied[cell / 64] & bit) != 0);
+      if (occupied)
+      {
+        m_Occupied[cell / 64] |= bit;
+      }
+      else
+      {
+        m_Occupied[cell / 64] &= ~bit;
+      }
+    }
+
+  public:
+    Tile get(unsigned x, unsigned y) const
+    {
+      if (x >= Size || y >= Size)
+      {
+        return Tile();
+      }
+      return m_Tiles[y * Size + x];
+    }
+
+    void set(unsigned x, unsigned y, Tile tile)
+    {
+      if (x >= Size || y >= Size)
+      {
+        return;
+      }
+
+      auto cell = y * Size + x;
+      m_Tiles[cell] = tile.index != 0 ? tile : Tile();
+      mark(cell, tile.index != 0);
+    }
+
+    // Size tiles of row y
+    const Tile* row(unsigned y) const
+    {
+      return &m_Tiles[y * Size];
+    }
+
+    // copies the top left w x h tiles of src to dstX/dstY, empty tiles of src clear their target, clipped to both grids
+    template<unsigned SrcSize>
+    void copy(const TileGrid<SrcSize>& src, int dstX, int dstY, unsigned w, unsigned h)
+    {
+      int beginX = std::max(0, -dstX);
+      int beginY = std::max(0, -dstY);
+      int endX = std::min(static_cast<int>(std::min(w, SrcSize)), static_cast<int>(Size) - dstX);
+      int endY = std::min(static_cast<int>(std::min(h, SrcSize)), static_cast<int>(Size) - dstY);
+
+      if (beginX >= endX)
+      {
+        return;
+      }
+
+      for (auto y = beginY; y < endY; y++)
+      {
+        auto* from = src.row(y);
+        int firstCell = (y + dstY) * static_cast<int>(Size) + dstX;
+        std::copy(from + beginX, from + endX, m_Tiles.begin() + firstCell + beginX);
+
+        for (auto x = beginX; x < endX; x++)
+        {
+          mark(firstCell + x, from[x].index != 0);
+        }
+      }
+    }
+
+    void clear()
+    {
+      m_Tiles.fill(Tile());
+      m_Occupied.fill(0);
+      m_Count = 0;
+    }
+
+    size_t count() const
+    {
+      return m_Count;
+    }
+
+    bool empty() const
+    {
+      return m_Count == 0;
+    }
+
+    // lam(unsigned x, unsigned y, const Tile& tile) for every occupied cell, row by row
+    template<typename Lambda>
+    void for_each(Lambda&& lam) const
+    {
+      for (auto word = 0u; word < wordCount; word++)
+      {
+        auto bits = m_Occupied[word];
+        while (bits != 0)
+        {
+          auto cell = word * 64 + static_cast<unsigned>(__builtin_ctzll(bits));
+          lam(cell % Size, cell / Size, m_Tiles[cell]);
+          bits &= bits - 1;
+        }
+      }
+    }
+
+    template<typename Archive>
+    void serialize(Archive& ar)
+    {
+      if constexpr (!Archive::isWriting)
+      {
+        if (ar.version == 0)
+        {
+          readNested(ar);
+          return;
+        }
+      }
+
+      ar(m_Occupied);
+
+      if constexpr (!Archive::isWriting)
+      {
+        // bits past the last cell would index outside of m_Tiles
+        if (cellCount % 64 != 0)
+        {
+          m_Occupied[wordCount - 1] &= (uint64_t(1) << (cellCount % 64)) - 1;
+        }
+        m_Tiles.fill(Tile());
+
+        m_Count = 0;
+        for (auto word : m_Occupied)
+        {
+          m_Count += static_cast<unsigned>(__builtin_popcountll(word));
+        }
+      }
+
+      for (auto word = 0u; word < wordCount; word++)
+      {
+        for (auto bits = m_Occupied[word]; bits != 0; bits &= bits - 1)
+        {
+          auto cell = word * 64 + static_cast<unsigned>(__builtin_ctzll(bits));
+          ar(m_Tiles[cell]);
+
+          if constexpr (!Archive::isWriting)
+          {
+            mark(cell, m_Tiles[cell].index != 0);
+          }
+        }
+      }
+    }
+
+    // version 0: uint32 rows, each uint32 count + tiles
+    template<typename Archive>
+    void readNested(Archive& ar)
+    {
+      std::vector<std::vector<Tile>> nested;
+      ar(nested);
+
+      clear();
+      for (auto y = 0u; y < nested.size(); y++)
+      {
+        for (auto x = 0u; x < nested[y].size(); x++)
+        {
+          set(x, y, nested[y][x]);
+        }
+      }
+    }
+};
+
+#endif /* TILEGRID_H */
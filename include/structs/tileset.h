@@ -1,26 +1,30 @@
-#ifndef TILELAYER_H
-#define TILELAYER_H
+#ifndef TILESET_H
+#define TILESET_H
 
 #include <vector>
 #include <string>
 
 #include "structs/tile.h"
-#include "game/saveable.h"
+#include "structs/tilegrid.h"
 #include "game/filesystem.hpp"
+#include "game/gamemath.hpp"
 
-struct Tileset : public Saveable
+// tiles of one tileset inside a chunk
+using TileLayer = TileGrid<game::math::chunkSize>;
+
+struct Tileset
 {
   float offsetX;
   float offsetY;
 
   float scale;
 
-  std::vector<std::vector<Tile>> tileData;
+  TileLayer tileData;
 
   // unique tilesetid
   unsigned id;
 
-  Tileset(unsigned id, float offsetX, float offsetY, float scale, std::vector<std::vector<Tile>>& tileData)
+  Tileset(unsigned id, float offsetX, float offsetY, float scale, const TileLayer& tileData = TileLayer())
   {
     this->offsetX = offsetX;
     this->offsetY = offsetY;
@@ -35,40 +39,23 @@ struct Tileset : public Saveable
 
   void printTiles() const
   {
-    for (auto& tilevec : tileData)
+    for (auto y = 0u; y < TileLayer::size; y++)
     {
-      for (auto& tile : tilevec)
+      for (auto x = 0u; x < TileLayer::size; x++)
       {
-        printf("%c ", tile.index, tile.rot);
+        printf("%c ", tileData.get(x, y).index);
       }
       printf("\n");
     }
   }
 
-  void write(std::ofstream& out) override
-  {
-    // write pod
-    filesystem::writeStruct(out, offsetX);
-    filesystem::writeStruct(out, offsetY);
-    filesystem::writeStruct(out, scale);
-    filesystem::writeStruct(out, id);
-
-    // write tiledata
-    filesystem::writeRange(out, tileData);
-  }
-
-  void read(std::ifstream& in) override
+  template<typename Archive>
+  void serialize(Archive& ar)
   {
-    // read pod
-    filesystem::readStruct(in, offsetX);
-    filesystem::readStruct(in, offsetY);
-    filesystem::readStruct(in, scale);
-    filesystem::readStruct(in, id);
-
-    // read tileData
-    filesystem::readRange(in, tileData);
+    ar(offsetX, offsetY, scale, id);
+    ar(tileData);
   }
 };
 
 
-#endif /* TILELAYER_H */
+#endif /* TILESET_H */
@@ -21,22 +21,27 @@
 #include <getopt.h>
 
 #include "controller.h"
+#include "renderer/simplesprite.h"
 #include "game/force.hpp"
 #include "game/gamemath.hpp"
+#include "game/profiler.h"
+#include "game/replay.h"
 
-void Controller::init(int argc, char** argv)
+bool Controller::init(int argc, char** argv)
 {
   struct {
     unsigned int windowWidth;
     unsigned int windowHeight;
     bool fullscreen;
-  } args = {800, 600, false};
+    const char* profileOutput;
+    const char* recordOutput;
+  } args = {800, 600, false, nullptr, nullptr};
   
   extern char* optarg;
   extern int optind;
   int c;
 
-  while((c = getopt(argc, argv, "x:y:f")) != -1)
+  while((c = getopt(argc, argv, "x:y:fp:r:")) != -1)
   {
     switch(c)
     {
@@ -48,13 +53,42 @@ void Controller::init(int argc, char** argv)
         break;
       case 'f':
         args.fullscreen = true;
+        break;
+      case 'p':
+        args.profileOutput = optarg;
+        break;
+      case 'r':
+        args.recordOutput = optarg;
+        break;
     }
   }
 
   global::tickCount = 0;
   global::lastTickDuration = .0f;
   
+  if (args.profileOutput != nullptr)
+  {
+    m_ProfileOutput = args.profileOutput;
+    profiler::setEnabled(true);
+  }
+  
+  if (args.recordOutput != nullptr && !m_Recorder.open(args.recordOutput))
+  {
+    printf("[REPLAY] can't record to %s\n", args.recordOutput);
+  }
+  
   m_Model = new Model();
+  
+  auto* map = m_Model->getMap();
+  if (map->getLoadResult() == Map::LoadResult::Damaged)
+  {
+    auto path = map->getDataFilePath();
+    printf("[MAP] %s is damaged and kept as %s.damaged. Restore it from a backup or remove the map folder to start a new map\n", path.c_str(), path.c_str());
+    delete m_Model;
+    m_Model = nullptr;
+    return false;
+  }
+  
   m_Renderer = new Renderer(args.windowWidth, args.windowHeight, args.fullscreen, m_Model->getMap());
   m_Quit = false;
   
@@ -64,9 +98,28 @@ void Controller::init(int argc, char** argv)
   m_Editor = new Editor(m_Model->getMap(), m_Renderer);
 
   SDL_SetRelativeMouseMode(SDL_FALSE);
+  return true;
 }
 
-unsigned int selectedEntityId = 0;
+namespace
+{
+  uint16_t keysFromState(const Uint8* keystate)
+  {
+    uint16_t keys = 0;
+    
+    if (keystate[SDL_SCANCODE_W]) keys |= replay::KEY_W;
+    if (keystate[SDL_SCANCODE_A]) keys |= replay::KEY_A;
+    if (keystate[SDL_SCANCODE_S]) keys |= replay::KEY_S;
+    if (keystate[SDL_SCANCODE_D]) keys |= replay::KEY_D;
+    if (keystate[SDL_SCANCODE_E]) keys |= replay::KEY_E;
+    if (keystate[SDL_SCANCODE_Q]) keys |= replay::KEY_Q;
+    if (keystate[SDL_SCANCODE_R]) keys |= replay::KEY_R;
+    if (keystate[SDL_SCANCODE_F]) keys |= replay::KEY_F;
+    if (keystate[SDL_SCANCODE_V]) keys |= replay::KEY_V;
+    
+    return keys;
+  }
+}
 
 void Controller::handleSDLEvents()
 {
@@ -89,47 +142,43 @@ void Controller::handleSDLEvents()
       case SDL_MOUSEWHEEL:
         m_Editor->mouseWheelEvent(evt.wheel);
         break;
+      case SDL_KEYDOWN:
+        // only the view, not part of replays
+        if (evt.key.keysym.sym == SDLK_m && evt.key.repeat == 0)
+        {
+          m_ShowMinimap = !m_ShowMinimap;
+          m_Renderer->setMinimap(0, m_ShowMinimap);
+        }
+        break;
       case SDL_MOUSEBUTTONDOWN:
         m_Editor->mouseButtonEvent(evt.button);
         if (evt.button.clicks == 1)
         {
           vec2<float> clickXY = m_Renderer->pixelToXYAuto(vec2<float>(static_cast<float>(evt.button.x), static_cast<float>(evt.button.y)));
+          auto* map = m_Model->getMap();
           
-          auto* entity = m_Model->getMap()->get_entity_at<Entity>(clickXY);
+          auto previousId = m_Input.getSelectedEntityId();
+          m_Input.click(*map, clickXY);
+          auto selectedId = m_Input.getSelectedEntityId();
           
-          if (entity != nullptr)
+          if (m_Recorder.isOpen())
           {
-            selectedEntityId = entity->getId();
-            auto* selectedEntity = m_Model->getMap()->get_entity_by_id<Entity>(selectedEntityId);
-            if (selectedEntity != nullptr)
-            {
-              selectedEntity->setSprite(nullptr);
-            }
-            selectedEntity = entity;
-            
-            selectedEntityId = selectedEntity->getId();
-            
-            selectedEntity->setSprite(std::make_shared<SimpleSprite>("data/img/testEntitySelected.png"));
+            m_Frame.clicks.push_back(clickXY);
           }
-          else
+          
+          if (previousId != selectedId)
           {
-            if (selectedEntityId != 0)
+            auto* previous = map->get_entity_by_id<Entity>(previousId);
+            if (previous != nullptr)
             {
-              auto* selectedEntity = m_Model->getMap()->get_entity_by_id<Entity>(selectedEntityId);
-              selectedEntity->setSprite(nullptr);
+              previous->setSprite(nullptr);
             }
-            else
+            
+            auto* selected = map->get_entity_by_id<Entity>(selectedId);
+            if (selected != nullptr)
             {
-              m_Model->getMap()->for_each_entity_in_range<PhysicsEntity>(clickXY, 20.f, 
-                [&](auto& entity) -> void
-                {
-                  auto diff = (entity.getPos() - clickXY);
-                  auto forcedir = game::math::norm(diff);
-                  entity.addForce(game::Force( forcedir * -50.f, .0f)); 
-                }
-              );
+              selected->setSprite(std::make_shared<SimpleSprite>("data/img/testEntitySelected.png"));
             }
-            selectedEntityId = 0;
           }
         }
         break;
@@ -147,6 +196,18 @@ void Controller::handleSDLEvents()
 
 void Controller::quit() 
 {
+  if (!m_ProfileOutput.empty())
+  {
+    profiler::printSummary();
+    if (profiler::writeChromeTrace(m_ProfileOutput))
+    {
+      printf("[PROFILER] trace written to %s\n", m_ProfileOutput.c_str());
+    }
+  }
+  
+  auto flushed = m_Model->getMap()->flush();
+  printf("[MAP] saved %zu chunks in %.1f ms\n", flushed.chunks, flushed.seconds * 1000.f);
+  
   delete m_Model;
   delete m_Renderer;
   delete m_Editor;
@@ -157,37 +218,27 @@ void Controller::handleInput()
 {
   const auto* keystate = SDL_GetKeyboardState(NULL);
   auto camSpeed = 30.f * global::lastTickDuration;
-  auto moveForce = 4.f;
   
-  auto moveVec = game::vec2<float>(.0f, .0f);
+  auto keys = keysFromState(keystate);
+  auto moveVec = replay::moveDirection(keys);
   
   m_Editor->handleKeyState(keystate);
 
-  if (keystate[SDL_SCANCODE_W]) moveVec += { .0f, -1.f};
-  if (keystate[SDL_SCANCODE_A]) moveVec += {-1.f,  .0f};
-  if (keystate[SDL_SCANCODE_S]) moveVec += { .0f,  1.f};
-  if (keystate[SDL_SCANCODE_D]) moveVec += { 1.f,  .0f};
-  if (keystate[SDL_SCANCODE_E]) m_Renderer->toggleFullscreen();
-  if (keystate[SDL_SCANCODE_Q]) m_Quit = true;
-  if (keystate[SDL_SCANCODE_R]) m_Renderer->zoomCamera(0, 0.9);
-  if (keystate[SDL_SCANCODE_F]) m_Renderer->zoomCamera(0, 1.111111111111111);
-  if (keystate[SDL_SCANCODE_V]) m_Renderer->setScale(0, m_IdealCameraScale);
-  
-  moveVec.norm();
+  if (keys & replay::KEY_E) m_Renderer->toggleFullscreen();
+  if (keys & replay::KEY_Q) m_Quit = true;
+  if (keys & replay::KEY_R) m_Renderer->zoomCamera(0, 0.9);
+  if (keys & replay::KEY_F) m_Renderer->zoomCamera(0, 1.111111111111111);
+  if (keys & replay::KEY_V) m_Renderer->setScale(0, m_IdealCameraScale);
+  
+  if (m_Recorder.isOpen())
+  {
+    m_Frame.keys = keys;
+  }
 
-  if (selectedEntityId != 0)
+  auto* selectedEntity = m_Input.moveSelected(*m_Model->getMap(), keys);
+  if (selectedEntity != nullptr)
   {
-    auto* selectedEntity = m_Model->getMap()->get_entity_by_id<Entity>(selectedEntityId);
-    selectedEntity = m_Model->getMap()->get_entity_by_id<Entity>(selectedEntityId);
-    if (selectedEntity != nullptr)
-    {
-      selectedEntity->setPos(selectedEntity->getPos() + (moveVec * 0.05f));
-      m_Renderer->setCameraPos(0, selectedEntity->getPos());
-    }
-    else
-    {
-      selectedEntityId = 0;
-    }
+    m_Renderer->setCameraPos(0, selectedEntity->getPos());
   }
   else
   {
@@ -202,6 +253,8 @@ float FPSSum = 0.f;
 
 bool Controller::tick()
 {
+  PROFILE_ZONE("Controller::tick");
+  
   auto time1 = SDL_GetTicks();
   FPSSum += global::lastTickDuration;
   
@@ -209,6 +262,11 @@ bool Controller::tick()
   {
     printf("FPS:\t%.1f\n", 1.f / (FPSSum / 100.f));
     FPSSum = 0.f;
+    
+    if (profiler::isEnabled())
+    {
+      profiler::printSummary();
+    }
   }
   
   handleSDLEvents();
@@ -220,7 +278,19 @@ bool Controller::tick()
     return false;
   }
   
+  if (m_Recorder.isOpen())
+  {
+    m_Frame.tickDuration = global::lastTickDuration;
+    m_Frame.cameras = m_Renderer->getCameraPositions();
+    m_Recorder.record(m_Frame);
+    m_Frame.clear();
+  }
+  
   m_Model->tick();
+  if (global::tickCount != 0 && global::tickCount % m_AutosaveTicks == 0)
+  {
+    m_Model->getMap()->autosave();
+  }
   m_Renderer->tick(0.01);
   
   m_Renderer->show();
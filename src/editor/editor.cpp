@@ -71,35 +71,33 @@ void Editor::handleKeyState(const Uint8* keystate)
     {
       if (tileSelectionPos != game::vec2<int> { -1, -1 })
       {
-        for (auto x = 0u; x <= tileSelectionSize[0]; x++)
+        auto mouseWorldPos = m_Renderer->pixelToXYAuto(mousePosition);
+        auto left = static_cast<int>(floor(mouseWorldPos[0]));
+        auto top  = static_cast<int>(floor(mouseWorldPos[1]));
+        auto width  = tileSelectionSize[0] + 1;
+        auto height = tileSelectionSize[1] + 1;
+
+        // every chunk under the selection gets its part in one copy
+        for (auto chunkY = game::math::entityToChunkY(top); chunkY <= game::math::entityToChunkY(top + height - 1); chunkY++)
         {
-          for (auto y = 0u; y <= tileSelectionSize[1]; y++)
+          for (auto chunkX = game::math::entityToChunkX(left); chunkX <= game::math::entityToChunkX(left + width - 1); chunkX++)
           {
-            auto chunkLock = m_Map->getIdealChunk(m_Renderer->pixelToXYAuto(mousePosition) + game::vec2<float> { x, y });
-            if (chunkLock)
+            auto chunkLock = m_Map->getIdealChunk(game::vec2<int> { chunkX, chunkY });
+            if (!chunkLock)
             {
-              Chunk* chunk = chunkLock->get();
-              auto tilePos = game::vec2<float>{m_Renderer->pixelToXYAuto(mousePosition)[0] + x, m_Renderer->pixelToXYAuto(mousePosition)[1] + y} -game::math::chunkToEntityPos(chunk->getPos());
-              auto tileset = getTilesetById(m_SelectedTilesetId, chunk);
-              if (tileset)
-              {
-                (*tileset)->tileData[static_cast<int> (tilePos[1]) % game::math::chunkSize][static_cast<int> (tilePos[0]) % game::math::chunkSize] = selectedTiles[x][y];
-              } else
-              {
-                std::vector<std::vector < Tile>> tileData;
-
-                for (int y = 0; y < game::math::chunkSize; y++)
-                {
-                  std::vector<Tile> temp;
-                  temp.resize(game::math::chunkSize, Tile(0, .0f));
-                  tileData.push_back(temp);
-                }
+              continue;
+            }
 
-                chunk->m_Data.m_Tilesets.push_back(Tileset(m_SelectedTilesetId, 0.f, 0.f, 1.0f, tileData));
-                y--;
-                continue;
-              }
+            Chunk* chunk = chunkLock->get();
+            auto tileset = getTilesetById(m_SelectedTilesetId, chunk);
+            if (!tileset)
+            {
+              chunk->m_Data.m_Tilesets.push_back(Tileset(m_SelectedTilesetId, 0.f, 0.f, 1.0f));
+              tileset = &chunk->m_Data.m_Tilesets.back();
             }
+
+            (*tileset)->tileData.copy(selectedTiles, left - chunkX * game::math::chunkSize, top - chunkY * game::math::chunkSize, width, height);
+            chunk->touch();
           }
         }
       }
@@ -196,12 +194,10 @@ void Editor::tileSelectionTick()
       
       for (auto x = 0u; x <= tileSelectionSize[0]; x++)
       {
-        std::vector<Tile> temp;
         for (auto y = 0u; y <= tileSelectionSize[1]; y++)
         {
-          temp.push_back(Tile {tileSelectionPos[0] + x + ( 16 * ( tileSelectionPos[1] + y)), 0.f});
+          selectedTiles.set(x, y, Tile {static_cast<char>(tileSelectionPos[0] + x + ( 16 * ( tileSelectionPos[1] + y))), 0.f});
         }
-        selectedTiles.push_back(temp);
       }
       
       selectingTile = false;
@@ -324,17 +320,8 @@ void Editor::addTileset()
       
      
       
-      std::vector<std::vector<Tile>> tileData;
-      
-      for(int y = 0; y < game::math::chunkSize; y++)
-      {
-        std::vector<Tile> temp;
-        temp.resize(game::math::chunkSize, Tile(0, .0f));
-        tileData.push_back(temp);
-      }
-      
-      
-      chunk->m_Data.m_Tilesets.push_back(Tileset(m_Map->addNewTileset(tilesetImg), 0.f, 0.f, 1.0f, tileData));
+      chunk->m_Data.m_Tilesets.push_back(Tileset(m_Map->addNewTileset(tilesetImg), 0.f, 0.f, 1.0f));
+      chunk->touch();
       m_LastTickTilesetChanged = true;
     }
   }
@@ -0,0 +1,100 @@
+/*
+ *  FILENAME:      checksum.cpp
+ *
+ *  DESCRIPTION:
+ *      CRC-32 framing of files written through filesystem::
+ *
+ */
+
+#include <array>
+#include <cstring>
+
+#include "game/checksum.h"
+
+namespace
+{
+  constexpr char magic[4] = { 'B', 'S', 'U', 'M' };
+
+  // slicing by 4: four table lookups per 32 bit word instead of four dependent byte steps
+  using Tables = std::array<std::array<uint32_t, 256>, 4>;
+
+  Tables makeTables()
+  {
+    Tables tables { };
+    for (uint32_t i = 0; i < 256; i++)
+    {
+      uint32_t crc = i;
+      for (auto bit = 0; bit < 8; bit++)
+      {
+        crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+      }
+      tables[0][i] = crc;
+    }
+    for (uint32_t i = 0; i < 256; i++)
+    {
+      for (auto t = 1u; t < tables.size(); t++)
+      {
+        tables[t][i] = (tables[t - 1][i] >> 8) ^ tables[0][tables[t - 1][i] & 0xff];
+      }
+    }
+    return tables;
+  }
+
+  const Tables tables = makeTables();
+}
+
+namespace checksum
+{
+  uint32_t crc32(const uint8_t* data, size_t size)
+  {
+    uint32_t crc = 0xFFFFFFFFu;
+
+    // words are assembled byte by byte, so this doesn't depend on the host's endianness
+    for (; size >= 4; size -= 4, data += 4)
+    {
+      crc ^= static_cast<uint32_t>(data[0]) | static_cast<uint32_t>(data[1]) << 8 | static_cast<uint32_t>(data[2]) << 16 | static_cast<uint32_t>(data[3]) << 24;
+      crc = tables[3][crc & 0xff] ^ tables[2][(crc >> 8) & 0xff] ^ tables[1][(crc >> 16) & 0xff] ^ tables[0][crc >> 24];
+    }
+    for (; size > 0; size--, data++)
+    {
+      crc = (crc >> 8) ^ tables[0][(crc ^ *data) & 0xff];
+    }
+
+    return crc ^ 0xFFFFFFFFu;
+  }
+
+  void seal(std::vector<uint8_t>& data)
+  {
+    uint32_t crc = crc32(data.data(), data.size());
+
+    uint8_t header[headerSize];
+    std::memcpy(header, magic, sizeof(magic));
+    std::memcpy(header + sizeof(magic), &crc, sizeof(crc));
+
+    data.insert(data.begin(), header, header + headerSize);
+  }
+
+  bool isSealed(const std::vector<uint8_t>& data)
+  {
+    return data.size() >= headerSize && std::memcmp(data.data(), magic, sizeof(magic)) == 0;
+  }
+
+  bool unseal(std::vector<uint8_t>& data)
+  {
+    if (!isSealed(data))
+    {
+      return true;
+    }
+
+    uint32_t crc;
+    std::memcpy(&crc, data.data() + sizeof(magic), sizeof(crc));
+
+    if (crc32(data.data() + headerSize, data.size() - headerSize) != crc)
+    {
+      return false;
+    }
+
+    data.erase(data.begin(), data.begin() + headerSize);
+    return true;
+  }
+}
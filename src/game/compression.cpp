@@ -0,0 +1,301 @@
+/*
+ *  FILENAME:      compression.cpp
+ *
+ *  DESCRIPTION:
+ *      Block compression for files written through filesystem::
+ *
+ */
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#include "game/compression.h"
+
+namespace
+{
+  constexpr char magic[3] = { 'B', 'L', 'Z' };
+
+  // LZ4 block format limits
+  constexpr size_t minMatch        = 4;
+  constexpr size_t lastLiterals    = 5;
+  constexpr size_t matchStartLimit = 12;
+  constexpr size_t maxOffset       = 65535;
+  constexpr unsigned hashBits      = 12;
+
+  uint32_t read32(const uint8_t* p)
+  {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+  }
+
+  uint32_t hash(uint32_t sequence)
+  {
+    return (sequence * 2654435761u) >> (32 - hashBits);
+  }
+
+  void writeLength(std::vector<uint8_t>& out, size_t length)
+  {
+    while (length >= 255)
+    {
+      out.push_back(255);
+      length -= 255;
+    }
+    out.push_back(static_cast<uint8_t>(length));
+  }
+
+  bool readLength(const uint8_t* src, size_t size, size_t& ip, size_t& length)
+  {
+    uint8_t byte;
+    do
+    {
+      if (ip >= size)
+      {
+        return false;
+      }
+      byte = src[ip++];
+      length += byte;
+    } while (byte == 255);
+
+    return true;
+  }
+
+  void writeSequence(std::vector<uint8_t>& out, const uint8_t* literals, size_t literalCount, size_t offset, size_t matchLength)
+  {
+    size_t matchCode = matchLength - minMatch;
+    out.push_back(static_cast<uint8_t>((std::min<size_t>(literalCount, 15) << 4) | std::min<size_t>(matchCode, 15)));
+
+    if (literalCount >= 15)
+    {
+      writeLength(out, literalCount - 15);
+    }
+    out.insert(out.end(), literals, literals + literalCount);
+
+    out.push_back(static_cast<uint8_t>(offset & 0xff));
+    out.push_back(static_cast<uint8_t>(offset >> 8));
+
+    if (matchCode >= 15)
+    {
+      writeLength(out, matchCode - 15);
+    }
+  }
+
+  void writeLastLiterals(std::vector<uint8_t>& out, const uint8_t* literals, size_t literalCount)
+  {
+    out.push_back(static_cast<uint8_t>(std::min<size_t>(literalCount, 15) << 4));
+    if (literalCount >= 15)
+    {
+      writeLength(out, literalCount - 15);
+    }
+    out.insert(out.end(), literals, literals + literalCount);
+  }
+}
+
+namespace compression
+{
+  const char* codecName(Codec codec)
+  {
+    switch (codec)
+    {
+      case Codec::None: return "none";
+      case Codec::LZ4:  return "lz4";
+    }
+    return "?";
+  }
+
+  void compressLZ4(const uint8_t* src, size_t size, std::vector<uint8_t>& out)
+  {
+    // positions + 1, 0 marks an empty slot
+    std::array<uint32_t, 1 << hashBits> table { };
+
+    size_t anchor = 0;
+    size_t ip = 0;
+
+    if (size >= matchStartLimit + 1)
+    {
+      const size_t matchEndLimit = size - lastLiterals;
+      const size_t ipLimit = size - matchStartLimit;
+
+      while (ip <= ipLimit)
+      {
+        uint32_t sequence = read32(src + ip);
+        uint32_t h = hash(sequence);
+        size_t candidate = table[h];
+        table[h] = static_cast<uint32_t>(ip + 1);
+
+        if (candidate == 0 || ip - (candidate - 1) > maxOffset || read32(src + candidate - 1) != sequence)
+        {
+          // skip faster through data that doesn't compress
+          ip += 1 + ((ip - anchor) >> 6);
+          continue;
+        }
+
+        size_t ref = candidate - 1;
+
+        // the match may start before ip
+        while (ip > anchor && ref > 0 && src[ip - 1] == src[ref - 1])
+        {
+          ip--;
+          ref--;
+        }
+
+        size_t length = minMatch;
+        while (ip + length < matchEndLimit && src[ip + length] == src[ref + length])
+        {
+          length++;
+        }
+
+        writeSequence(out, src + anchor, ip - anchor, ip - ref, length);
+
+        ip += length;
+        anchor = ip;
+
+        if (ip - 2 <= ipLimit)
+        {
+          table[hash(read32(src + ip - 2))] = static_cast<uint32_t>(ip - 2 + 1);
+        }
+      }
+    }
+
+    writeLastLiterals(out, src + anchor, size - anchor);
+  }
+
+  bool decompressLZ4(const uint8_t* src, size_t size, uint8_t* dst, size_t dstSize)
+  {
+    size_t ip = 0;
+    size_t op = 0;
+
+    while (ip < size)
+    {
+      uint8_t token = src[ip++];
+
+      size_t literalCount = token >> 4;
+      if (literalCount == 15 && !readLength(src, size, ip, literalCount))
+      {
+        return false;
+      }
+      if (literalCount > size - ip || literalCount > dstSize - op)
+      {
+        return false;
+      }
+      if (literalCount > 0)
+      {
+        std::memcpy(dst + op, src + ip, literalCount);
+      }
+      ip += literalCount;
+      op += literalCount;
+
+      // the last sequence has no match
+      if (ip == size)
+      {
+        break;
+      }
+
+      if (size - ip < 2)
+      {
+        return false;
+      }
+      size_t offset = src[ip] | (static_cast<size_t>(src[ip + 1]) << 8);
+      ip += 2;
+
+      if (offset == 0 || offset > op)
+      {
+        return false;
+      }
+
+      size_t matchLength = token & 15;
+      if (matchLength == 15 && !readLength(src, size, ip, matchLength))
+      {
+        return false;
+      }
+      matchLength += minMatch;
+
+      if (matchLength > dstSize - op)
+      {
+        return false;
+      }
+
+      const uint8_t* match = dst + op - offset;
+      if (offset >= matchLength)
+      {
+        std::memcpy(dst + op, match, matchLength);
+      }
+      else
+      {
+        // overlaps its own output (runs), has to go byte by byte
+        for (auto i = 0u; i < matchLength; i++)
+        {
+          dst[op + i] = match[i];
+        }
+      }
+      op += matchLength;
+    }
+
+    return op == dstSize;
+  }
+
+  void pack(Codec codec, const std::vector<uint8_t>& raw, std::vector<uint8_t>& out)
+  {
+    out.clear();
+
+    // every codec gets the header, raw data that happens to start with the magic can't be mistaken for packed data
+    uint32_t rawSize = raw.size();
+    out.reserve(headerSize + (codec == Codec::None ? raw.size() : raw.size() / 2));
+    out.insert(out.end(), magic, magic + sizeof(magic));
+    out.push_back(static_cast<uint8_t>(codec));
+    out.resize(headerSize);
+    std::memcpy(out.data() + sizeof(magic) + 1, &rawSize, sizeof(rawSize));
+
+    if (codec == Codec::None)
+    {
+      out.insert(out.end(), raw.begin(), raw.end());
+      return;
+    }
+
+    compressLZ4(raw.data(), raw.size(), out);
+  }
+
+  bool unpack(std::vector<uint8_t>& data)
+  {
+    // only files written before compression existed have no header
+    if (data.size() < headerSize || std::memcmp(data.data(), magic, sizeof(magic)) != 0)
+    {
+      return true;
+    }
+
+    auto codec = static_cast<Codec>(data[sizeof(magic)]);
+    uint32_t rawSize;
+    std::memcpy(&rawSize, data.data() + sizeof(magic) + 1, sizeof(rawSize));
+
+    if (codec == Codec::None)
+    {
+      if (rawSize != data.size() - headerSize)
+      {
+        return false;
+      }
+      data.erase(data.begin(), data.begin() + headerSize);
+      return true;
+    }
+
+    if (codec != Codec::LZ4)
+    {
+      return false;
+    }
+
+    // an LZ4 block expands at most ~255x, anything above that is a broken header
+    if (rawSize / 255 > data.size())
+    {
+      return false;
+    }
+
+    std::vector<uint8_t> raw(rawSize);
+    if (!decompressLZ4(data.data() + headerSize, data.size() - headerSize, raw.data(), raw.size()))
+    {
+      return false;
+    }
+
+    data.swap(raw);
+    return true;
+  }
+}
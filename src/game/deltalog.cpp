@@ -0,0 +1,100 @@
+/*
+ *  FILENAME:      deltalog.cpp
+ *
+ *  DESCRIPTION:
+ *      Append-only log of changes on top of a saved file
+ *
+ */
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include "game/deltalog.h"
+#include "game/checksum.h"
+#include "game/filesystem.hpp"
+
+namespace deltalog
+{
+  bool append(const std::string& path, uint32_t base, const std::vector<uint8_t>& payload)
+  {
+    uint32_t header[3] = { static_cast<uint32_t>(payload.size()), base, checksum::crc32(payload.data(), payload.size()) };
+
+    std::vector<uint8_t> record(recordHeaderSize + payload.size());
+    std::memcpy(record.data(), header, recordHeaderSize);
+    if (!payload.empty())
+    {
+      std::memcpy(record.data() + recordHeaderSize, payload.data(), payload.size());
+    }
+
+    std::scoped_lock lock(filesystem::fileMutex(path));
+
+    std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::app);
+    out.write(reinterpret_cast<const char*>(record.data()), record.size());
+    out.close();
+
+    if (!out)
+    {
+      return false;
+    }
+    filesystem::stats.bytesWritten += record.size();
+    filesystem::stats.filesWritten++;
+    return true;
+  }
+
+  size_t read(const std::string& path, uint32_t base, std::vector<std::vector<uint8_t>>& payloads)
+  {
+    payloads.clear();
+
+    std::scoped_lock lock(filesystem::fileMutex(path));
+
+    std::vector<uint8_t> buffer;
+    if (!filesystem::readFile(path, buffer))
+    {
+      return 0;
+    }
+
+    size_t used = 0;
+    size_t pos = 0;
+    while (buffer.size() - pos >= recordHeaderSize)
+    {
+      uint32_t header[3];
+      std::memcpy(header, buffer.data() + pos, recordHeaderSize);
+
+      auto size = header[0];
+      if (size > buffer.size() - pos - recordHeaderSize)
+      {
+        break;
+      }
+
+      const auto* payload = buffer.data() + pos + recordHeaderSize;
+      if (checksum::crc32(payload, size) != header[2])
+      {
+        break;
+      }
+
+      if (header[1] == base)
+      {
+        payloads.emplace_back(payload, payload + size);
+        used += recordHeaderSize + size;
+      }
+      pos += recordHeaderSize + size;
+    }
+
+    // cut off a torn record, or records appended later would sit behind it unread
+    if (pos < buffer.size())
+    {
+      std::error_code error;
+      std::filesystem::resize_file(path, pos, error);
+    }
+
+    return used;
+  }
+
+  void clear(const std::string& path)
+  {
+    std::scoped_lock lock(filesystem::fileMutex(path));
+    std::error_code error;
+    std::filesystem::remove(path, error);
+  }
+}
@@ -14,11 +14,15 @@
  *
  */
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 
 #include "game/entities/camera.h"
 #include "game/gamemath.hpp"
 
+Camera::Stats Camera::stats;
+
 Camera::~Camera()
 {
   GPU_FreeImage(image);
@@ -103,8 +107,34 @@ GPU_Rect Camera::getTile(GPU_Image* img, unsigned char index, unsigned char inse
   return r;
 }
 
+bool Camera::visibleRange(float first, float step, float extent, float view, unsigned count, unsigned& from, unsigned& to)
+{
+  //tile k covers first + k*step up to extent further and is visible if that overlaps 0..view.
+  //Rounded outwards, clamped before converting so far away tilesets can't overflow
+  if(!(step > 0.f))
+  {
+    return false;
+  }
+  float lowest  = std::floor((-extent - first) / step);
+  float highest = std::floor((view - first) / step);
+  if(highest < 0.f || lowest > count - 1.f)
+  {
+    return false;
+  }
+
+  from = static_cast<unsigned>(std::max(lowest, 0.f));
+  to   = static_cast<unsigned>(std::min(highest, count - 1.f));
+  return from <= to;
+}
+
 void Camera::renderTileset(const Tileset& ts, GPU_Image* img, float pad_x, float pad_y, float x_offset, float y_offset)
 {
+  if(ts.tileData.empty())
+  {
+    stats.tilesetsSkipped++;
+    return;
+  }
+
   float logicalWidth  = game::math::tileWidth  * ts.scale * pixelsInUnit();
   float logicalHeight = game::math::tileHeight * ts.scale * pixelsInUnit();
 
@@ -128,16 +158,33 @@ void Camera::renderTileset(const Tileset& ts, GPU_Image* img, float pad_x, float
   GPU_SetUniformf(GPU_GetUniformLocation(sp_tile, "scale"), getScale());
   */
   
-  for(int i=0; i<ts.tileData.size(); i++)
+  //only rows and columns that can reach into the image, the exact check stays per tile
+  unsigned firstJ, lastJ, firstI, lastI;
+  if(!visibleRange(initX, logicalWidth, realWidth, image->w, TileLayer::size, firstJ, lastJ) ||
+     !visibleRange(initY, logicalHeight, realHeight, image->h, TileLayer::size, firstI, lastI))
   {
-    for(int j=0; j<ts.tileData[i].size(); j++)
+    return;
+  }
+
+  for(unsigned i = firstI; i <= lastI; i++)
+  {
+    const Tile* row = ts.tileData.row(i);
+    for(unsigned j = firstJ; j <= lastJ; j++)
     {
-      char c;
-      if((c = ts.tileData[i][j].index) != 0
-         && (targetRect.x+targetRect.w > 0 && targetRect.y+targetRect.h > 0)
-         && (targetRect.x < image->w && targetRect.y < image ->h) ) 
+      const Tile& tile = row[j];
+      if(tile.index == 0)
       {
-        GPU_Rect sourceRect = getTile(img, c, 0);
+        continue;
+      }
+      stats.tilesVisited++;
+
+      targetRect.x = initX + j * logicalWidth;
+      targetRect.y = initY + i * logicalHeight;
+
+      if((targetRect.x+targetRect.w > 0 && targetRect.y+targetRect.h > 0)
+         && (targetRect.x < image->w && targetRect.y < image ->h)) 
+      {
+        GPU_Rect sourceRect = getTile(img, tile.index, 0);
         GPU_Rect roundedTarget = GPU_MakeRect(
           floor(targetRect.x),
           floor(targetRect.y),
@@ -145,39 +192,57 @@ void Camera::renderTileset(const Tileset& ts, GPU_Image* img, float pad_x, float
           ceil(targetRect.h)
         );
 
-        GPU_BlitRect(img, &sourceRect, image->target, &roundedTarget); //render from tile on given image to this cam's render image
-
+        //render from tile on given image to this cam's render image, turned around its center like the tilemap shader does
+        if(tile.turns == 0)
+        {
+          GPU_BlitRect(img, &sourceRect, image->target, &roundedTarget);
+        }
+        else
+        {
+          GPU_BlitRectX(img, &sourceRect, image->target, &roundedTarget, tile.rot(), sourceRect.w/2, sourceRect.h/2, GPU_FLIP_NONE);
+        }
+        stats.blits++;
       }
-      targetRect.x += logicalWidth;
     }
-    targetRect.y += logicalHeight;
-    targetRect.x = initX;
   }
   //GPU_DeactivateShaderProgram();
 }
 
-void Camera::render2dMap(int* data, SDL_Color (*conversion)(int), size_t w, size_t h)
+void Camera::renderTilemap(const Tileset& ts, GPU_Image* indexMap, float x_offset, float y_offset)
 {
-  float width = getSize()[0]/w, height = getSize()[1]/h;
-  for(size_t i=0; i<h; i++)
+  //one quad for the whole tileset, the tile shader resolves the tiles per fragment
+  float logicalWidth  = game::math::tileWidth  * ts.scale * pixelsInUnit();
+  float logicalHeight = game::math::tileHeight * ts.scale * pixelsInUnit();
+
+  GPU_Rect targetRect = GPU_MakeRect(
+    floor((getSize()[0]/2) - (getPos()[0] - x_offset) * pixelsInUnit() * ts.scale),
+    floor((getSize()[1]/2) - (getPos()[1] - y_offset) * pixelsInUnit() * ts.scale),
+    ceil(logicalWidth * indexMap->w),
+    ceil(logicalHeight * indexMap->h)
+  );
+
+  if((targetRect.x+targetRect.w > 0 && targetRect.y+targetRect.h > 0)
+     && (targetRect.x < image->w && targetRect.y < image->h))
   {
-    for(size_t j=0; j<w; j++)
-    {
-      SDL_Color col = {0,0,0,255};
-      if(conversion == NULL)
-      {
-        if(data[j+w*i])
-        {
-          col = {255,255,255,255};
-        }
-      } 
-      else
-      {
-        col = conversion(data[j+w*i]);
-      }
+    GPU_BlitRect(indexMap, NULL, image->target, &targetRect);
+    stats.blits++;
+  }
+}
 
-      GPU_RectangleFilled(image->target, j*width, i*height, (j+1)*width, (i+1)*height, col);
-    }
+void Camera::renderImage(GPU_Image* img, float x_offset, float y_offset, float w, float h)
+{
+  //stretches img over w*h world units with its upper left corner at x_offset|y_offset
+  GPU_Rect targetRect = GPU_MakeRect(
+    floor((getSize()[0]/2) - (getPos()[0] - x_offset) * pixelsInUnit()),
+    floor((getSize()[1]/2) - (getPos()[1] - y_offset) * pixelsInUnit()),
+    ceil(w * pixelsInUnit()),
+    ceil(h * pixelsInUnit())
+  );
+
+  if((targetRect.x+targetRect.w > 0 && targetRect.y+targetRect.h > 0)
+     && (targetRect.x < image->w && targetRect.y < image->h))
+  {
+    GPU_BlitRect(img, NULL, image->target, &targetRect);
   }
 }
 
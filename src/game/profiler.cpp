@@ -0,0 +1,295 @@
+/*
+ *  FILENAME:      profiler.cpp
+ *
+ *  DESCRIPTION:
+ *      Scoped timing zones recorded into per-thread ring buffers, with percentile summaries and Chrome trace export
+ *
+ */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+
+#include "game/profiler.h"
+
+namespace
+{
+  struct Event
+  {
+    uint64_t start;
+    uint64_t end;
+    uint32_t thread;
+    uint16_t zone;
+  };
+
+  // one ring buffer entry, published like a seqlock: sequence is odd while the owner writes it
+  // and 2 * (index + 1) once event index is complete, so readers can drop entries that changed under them
+  struct Slot
+  {
+    std::atomic<uint64_t> sequence { 0 };
+    std::atomic<uint64_t> start { 0 };
+    std::atomic<uint64_t> end { 0 };
+    // thread << 16 | zone
+    std::atomic<uint64_t> source { 0 };
+  };
+
+  struct ThreadBuffer
+  {
+    std::array<Slot, profiler::bufferCapacity> events;
+    // only written by the owning thread
+    std::atomic<uint64_t> head { 0 };
+    uint32_t thread;
+  };
+
+  struct Registry
+  {
+    std::mutex mutex;
+    std::vector<std::string> zones;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    std::vector<ThreadBuffer*> freeBuffers;
+    uint32_t nextThread = 0;
+  };
+
+  Registry& registry()
+  {
+    static Registry instance;
+    return instance;
+  }
+
+  std::atomic<bool> enabled { false };
+  const auto epoch = std::chrono::steady_clock::now();
+
+  // hands its buffer back once the thread finishes, so short lived I/O threads don't pile up buffers
+  struct ThreadBufferLease
+  {
+    ThreadBuffer* buffer = nullptr;
+
+    ThreadBuffer* get()
+    {
+      if (buffer == nullptr)
+      {
+        auto& reg = registry();
+        std::scoped_lock lock(reg.mutex);
+
+        if (reg.freeBuffers.empty())
+        {
+          reg.buffers.push_back(std::make_unique<ThreadBuffer>());
+          buffer = reg.buffers.back().get();
+        }
+        else
+        {
+          buffer = reg.freeBuffers.back();
+          reg.freeBuffers.pop_back();
+        }
+        buffer->thread = reg.nextThread++;
+      }
+      return buffer;
+    }
+
+    ~ThreadBufferLease()
+    {
+      if (buffer != nullptr)
+      {
+        auto& reg = registry();
+        std::scoped_lock lock(reg.mutex);
+        reg.freeBuffers.push_back(buffer);
+      }
+    }
+  };
+
+  thread_local ThreadBufferLease threadBuffer;
+
+  // copies every event still inside the ring buffers, skipping the ones their thread is overwriting right now
+  std::vector<Event> collect()
+  {
+    std::vector<Event> result;
+    auto& reg = registry();
+    std::scoped_lock lock(reg.mutex);
+
+    for (auto& buffer : reg.buffers)
+    {
+      uint64_t head  = buffer->head.load(std::memory_order_acquire);
+      uint64_t count = std::min<uint64_t>(head, profiler::bufferCapacity);
+
+      for (auto i = head - count; i < head; i++)
+      {
+        auto& slot = buffer->events[i % profiler::bufferCapacity];
+
+        uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+        if (sequence != 2 * (i + 1))
+        {
+          continue;
+        }
+
+        Event event;
+        event.start  = slot.start.load(std::memory_order_relaxed);
+        event.end    = slot.end.load(std::memory_order_relaxed);
+        uint64_t source = slot.source.load(std::memory_order_relaxed);
+        event.thread = static_cast<uint32_t>(source >> 16);
+        event.zone   = static_cast<uint16_t>(source & 0xffff);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) == sequence)
+        {
+          result.push_back(event);
+        }
+      }
+    }
+    return result;
+  }
+
+  float toMilliseconds(uint64_t ns)
+  {
+    return ns / 1000000.f;
+  }
+}
+
+namespace profiler
+{
+  uint16_t registerZone(const char* name)
+  {
+    auto& reg = registry();
+    std::scoped_lock lock(reg.mutex);
+
+    reg.zones.emplace_back(name);
+    return static_cast<uint16_t>(reg.zones.size() - 1);
+  }
+
+  void setEnabled(bool enable)
+  {
+    enabled.store(enable, std::memory_order_relaxed);
+  }
+
+  bool isEnabled()
+  {
+    return enabled.load(std::memory_order_relaxed);
+  }
+
+  uint64_t now()
+  {
+    // +1 so a valid timestamp is never 0
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count() + 1;
+  }
+
+  void record(uint16_t zone, uint64_t start, uint64_t end)
+  {
+    auto* buffer = threadBuffer.get();
+    uint64_t head = buffer->head.load(std::memory_order_relaxed);
+
+    auto& slot = buffer->events[head % bufferCapacity];
+
+    slot.sequence.store(2 * head + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.start.store(start, std::memory_order_relaxed);
+    slot.end.store(end, std::memory_order_relaxed);
+    slot.source.store(static_cast<uint64_t>(buffer->thread) << 16 | zone, std::memory_order_relaxed);
+    slot.sequence.store(2 * (head + 1), std::memory_order_release);
+
+    buffer->head.store(head + 1, std::memory_order_release);
+  }
+
+  std::vector<ZoneStats> summary()
+  {
+    auto events = collect();
+
+    std::vector<std::vector<uint64_t>> durations;
+    std::vector<std::string> zones;
+    {
+      auto& reg = registry();
+      std::scoped_lock lock(reg.mutex);
+      zones = reg.zones;
+    }
+    durations.resize(zones.size());
+
+    for (const auto& event : events)
+    {
+      if (event.zone < durations.size())
+      {
+        durations[event.zone].push_back(event.end - event.start);
+      }
+    }
+
+    std::vector<ZoneStats> result;
+    for (auto zone = 0u; zone < zones.size(); zone++)
+    {
+      auto& values = durations[zone];
+      if (values.empty())
+      {
+        continue;
+      }
+
+      auto percentile = [&](float p) -> uint64_t
+      {
+        auto nth = values.begin() + static_cast<size_t>(p * (values.size() - 1));
+        std::nth_element(values.begin(), nth, values.end());
+        return *nth;
+      };
+
+      ZoneStats stats;
+      stats.name  = zones[zone];
+      stats.count = values.size();
+      stats.p50   = toMilliseconds(percentile(.5f));
+      stats.p99   = toMilliseconds(percentile(.99f));
+      stats.max   = toMilliseconds(*std::max_element(values.begin(), values.end()));
+      result.push_back(stats);
+    }
+
+    return result;
+  }
+
+  void printSummary()
+  {
+    printf("%-32s %8s %10s %10s %10s\n", "zone", "count", "p50 ms", "p99 ms", "max ms");
+    for (const auto& stats : summary())
+    {
+      printf("%-32s %8zu %10.3f %10.3f %10.3f\n", stats.name.c_str(), stats.count, stats.p50, stats.p99, stats.max);
+    }
+  }
+
+  bool writeChromeTrace(const std::string& path)
+  {
+    std::ofstream out(path, std::ios::out);
+    if (!out.is_open())
+    {
+      return false;
+    }
+
+    auto events = collect();
+    std::vector<std::string> zones;
+    {
+      auto& reg = registry();
+      std::scoped_lock lock(reg.mutex);
+      zones = reg.zones;
+    }
+
+    std::sort(events.begin(), events.end(),
+      [](const Event& a, const Event& b) -> bool
+      {
+        return a.start < b.start;
+      }
+    );
+
+    // complete events ("ph":"X") in microseconds, see the Trace Event Format
+    out << "{\"traceEvents\":[\n";
+    for (auto i = 0u; i < events.size(); i++)
+    {
+      const auto& event = events[i];
+      char line[256];
+      snprintf(line, sizeof(line), "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}%s\n",
+        event.zone < zones.size() ? zones[event.zone].c_str() : "?",
+        event.thread,
+        event.start / 1000.0,
+        (event.end - event.start) / 1000.0,
+        i + 1 < events.size() ? "," : "");
+      out << line;
+    }
+    out << "],\"displayTimeUnit\":\"ms\"}\n";
+
+    return static_cast<bool>(out);
+  }
+}
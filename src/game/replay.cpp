@@ -0,0 +1,179 @@
+/*
+ *  FILENAME:      replay.cpp
+ *
+ *  DESCRIPTION:
+ *      Binary log of per tick input/tick data and the model side of input handling, so recorded sessions can be replayed headless
+ *
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include "game/replay.h"
+#include "game/filesystem.hpp"
+#include "game/force.hpp"
+#include "game/gamemath.hpp"
+#include "logic/map.h"
+
+namespace
+{
+  void writePositions(std::ofstream& out, const std::vector<game::vec2<float>>& positions)
+  {
+    // a tick with more than 255 clicks or cameras is not worth a bigger count field
+    uint8_t count = static_cast<uint8_t>(std::min<size_t>(positions.size(), 255));
+    filesystem::writeStruct(out, count);
+
+    for (auto i = 0u; i < count; i++)
+    {
+      float x = positions[i][0];
+      float y = positions[i][1];
+      filesystem::writeStruct(out, x);
+      filesystem::writeStruct(out, y);
+    }
+  }
+
+  void readPositions(std::ifstream& in, std::vector<game::vec2<float>>& positions)
+  {
+    uint8_t count = 0;
+    filesystem::readStruct(in, count);
+
+    positions.clear();
+    for (auto i = 0u; i < count; i++)
+    {
+      float x = 0.f;
+      float y = 0.f;
+      filesystem::readStruct(in, x);
+      filesystem::readStruct(in, y);
+      positions.emplace_back(x, y);
+    }
+  }
+}
+
+namespace replay
+{
+  void Frame::clear()
+  {
+    tickDuration = 0.f;
+    keys = 0;
+    cameras.clear();
+    clicks.clear();
+  }
+
+  bool Recorder::open(const std::string& path)
+  {
+    m_Out.open(path, std::ios::out | std::ios::binary);
+    if (!m_Out.is_open())
+    {
+      return false;
+    }
+
+    uint16_t fileVersion = version;
+    m_Out.write(magic, sizeof(magic));
+    filesystem::writeStruct(m_Out, fileVersion);
+
+    return static_cast<bool>(m_Out);
+  }
+
+  bool Recorder::isOpen() const
+  {
+    return m_Out.is_open();
+  }
+
+  void Recorder::record(const Frame& frame)
+  {
+    float tickDuration = frame.tickDuration;
+    uint16_t keys = frame.keys;
+
+    filesystem::writeStruct(m_Out, tickDuration);
+    filesystem::writeStruct(m_Out, keys);
+    writePositions(m_Out, frame.cameras);
+    writePositions(m_Out, frame.clicks);
+  }
+
+  bool Player::open(const std::string& path)
+  {
+    m_In.open(path, std::ios::in | std::ios::binary);
+    if (!m_In.is_open())
+    {
+      return false;
+    }
+
+    char fileMagic[sizeof(magic)];
+    uint16_t fileVersion = 0;
+    m_In.read(fileMagic, sizeof(fileMagic));
+    filesystem::readStruct(m_In, fileVersion);
+
+    return m_In && std::memcmp(fileMagic, magic, sizeof(magic)) == 0 && fileVersion == version;
+  }
+
+  bool Player::next(Frame& frame)
+  {
+    frame.clear();
+
+    filesystem::readStruct(m_In, frame.tickDuration);
+    filesystem::readStruct(m_In, frame.keys);
+    readPositions(m_In, frame.cameras);
+    readPositions(m_In, frame.clicks);
+
+    return static_cast<bool>(m_In);
+  }
+
+  game::vec2<float> moveDirection(uint16_t keys)
+  {
+    auto moveVec = game::vec2<float>(.0f, .0f);
+
+    if (keys & KEY_W) moveVec += { .0f, -1.f};
+    if (keys & KEY_A) moveVec += {-1.f,  .0f};
+    if (keys & KEY_S) moveVec += { .0f,  1.f};
+    if (keys & KEY_D) moveVec += { 1.f,  .0f};
+
+    return moveVec;
+  }
+
+  uint32_t Input::getSelectedEntityId() const
+  {
+    return m_SelectedEntityId;
+  }
+
+  void Input::click(Map& map, game::vec2<float> pos)
+  {
+    auto* entity = map.get_entity_at<Entity>(pos);
+
+    if (entity != nullptr)
+    {
+      m_SelectedEntityId = entity->getId();
+      return;
+    }
+
+    if (m_SelectedEntityId == 0)
+    {
+      map.for_each_entity_in_range<PhysicsEntity>(pos, 20.f,
+        [&](auto& physicsEntity) -> void
+        {
+          auto diff = (physicsEntity.getPos() - pos);
+          auto forcedir = game::math::norm(diff);
+          physicsEntity.addForce(game::Force( forcedir * -50.f, .0f));
+        }
+      );
+    }
+    m_SelectedEntityId = 0;
+  }
+
+  Entity* Input::moveSelected(Map& map, uint16_t keys)
+  {
+    if (m_SelectedEntityId == 0)
+    {
+      return nullptr;
+    }
+
+    auto* selectedEntity = map.get_entity_by_id<Entity>(m_SelectedEntityId);
+    if (selectedEntity == nullptr)
+    {
+      m_SelectedEntityId = 0;
+      return nullptr;
+    }
+
+    selectedEntity->setPos(selectedEntity->getPos() + (moveDirection(keys) * 0.05f));
+    return selectedEntity;
+  }
+}
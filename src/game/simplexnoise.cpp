@@ -26,7 +26,14 @@
 
 #include "game/simplexnoise.h"
 
+#include <algorithm>
 #include <cstdint>  // int32_t/uint8_t
+#include <iterator>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 /**
  * Computes the largest integer value not greater than the float one
@@ -54,9 +61,8 @@ static inline int32_t fastfloor(float fp) {
  * that it is not a problem for graphic texture as the noise features disappear
  * at a distance far enough to be able to see a repeatable pattern of 256.
  *
- * This needs to be exactly the same for all instances on all platforms,
- * so it's easiest to just keep it as static explicit data.
- * This also removes the need for any initialisation of this class.
+ * This is the table of default constructed instances, seeded instances shuffle their own
+ * (see SimplexNoise(uint32_t seed, ...)).
  *
  * Note that making this an uint32_t[] instead of a uint8_t[] might make the
  * code run faster on platforms with a high penalty for unaligned single
@@ -68,7 +74,7 @@ static inline int32_t fastfloor(float fp) {
  * A vector-valued noise over 3D accesses it 96 times, and a
  * float-valued 4D noise 64 times. We want this to fit in the cache!
  */
-static const uint8_t perm[256] = {
+static const uint8_t defaultPerm[256] = {
     151, 160, 137, 91, 90, 15,
     131, 13, 201, 95, 96, 53, 194, 233, 7, 225, 140, 36, 103, 30, 69, 142, 8, 99, 37, 240, 21, 10, 23,
     190, 6, 148, 247, 120, 234, 75, 0, 26, 197, 62, 94, 252, 219, 203, 117, 35, 11, 32, 57, 177, 33,
@@ -96,8 +102,41 @@ static const uint8_t perm[256] = {
  *
  * @return 8-bits hashed value
  */
-static inline uint8_t hash(int32_t i) {
-    return perm[static_cast<uint8_t>(i)];
+inline uint8_t SimplexNoise::hash(int32_t i) const {
+    return mPerm[static_cast<uint8_t>(i)];
+}
+
+/**
+ * splitmix32 step, the same sequence on every platform (unlike the std distributions)
+ */
+static inline uint32_t nextRandom(uint32_t& state) {
+    uint32_t z = (state += 0x9e3779b9u);
+    z = (z ^ (z >> 16)) * 0x85ebca6bu;
+    z = (z ^ (z >> 13)) * 0xc2b2ae35u;
+    return z ^ (z >> 16);
+}
+
+SimplexNoise::SimplexNoise(float frequency, float amplitude, float lacunarity, float persistence) :
+    mFrequency(frequency),
+    mAmplitude(amplitude),
+    mLacunarity(lacunarity),
+    mPersistence(persistence) {
+    std::copy(std::begin(defaultPerm), std::end(defaultPerm), mPerm);
+}
+
+SimplexNoise::SimplexNoise(uint32_t seed, float frequency, float amplitude, float lacunarity, float persistence) :
+    mFrequency(frequency),
+    mAmplitude(amplitude),
+    mLacunarity(lacunarity),
+    mPersistence(persistence) {
+    // Fisher-Yates shuffle of 0-255
+    for (int i = 0; i < 256; i++) {
+        mPerm[i] = static_cast<uint8_t>(i);
+    }
+    uint32_t state = seed;
+    for (uint32_t i = 255; i > 0; i--) {
+        std::swap(mPerm[i], mPerm[nextRandom(state) % (i + 1)]);
+    }
 }
 
 /* NOTE Gradient table to test if lookup-table are more efficient than calculs
@@ -172,7 +211,7 @@ static float grad(int32_t hash, float x, float y, float z) {
  *
  * @return Noise value in the range[-1; 1], value of 0 on all integer coordinates.
  */
-float SimplexNoise::noise(float x) {
+float SimplexNoise::noise(float x) const {
     float n0, n1;   // Noise contributions from the two "corners"
 
     // No need to skew the input space in 1D
@@ -211,7 +250,7 @@ float SimplexNoise::noise(float x) {
  *
  * @return Noise value in the range[-1; 1], value of 0 on all integer coordinates.
  */
-float SimplexNoise::noise(float x, float y) {
+float SimplexNoise::noise(float x, float y) const {
     float n0, n1, n2;   // Noise contributions from the three corners
 
     // Skewing/Unskewing factors for 2D
@@ -289,6 +328,107 @@ float SimplexNoise::noise(float x, float y) {
     return 45.23065f * (n0 + n1 + n2);
 }
 
+#if defined(__SSE2__)
+/**
+ * fastfloor() of 4 lanes
+ */
+static inline __m128i fastfloor4(__m128 fp) {
+    const __m128i i = _mm_cvttps_epi32(fp);
+    // the compare mask is -1 where fp < i
+    return _mm_add_epi32(i, _mm_castps_si128(_mm_cmplt_ps(fp, _mm_cvtepi32_ps(i))));
+}
+
+/**
+ * grad(hash, x, y) of 4 lanes
+ */
+static inline __m128 grad4(__m128i hash, __m128 x, __m128 y) {
+    const __m128i h = _mm_and_si128(hash, _mm_set1_epi32(0x3F));
+    const __m128 useX = _mm_castsi128_ps(_mm_cmplt_epi32(h, _mm_set1_epi32(4)));
+    const __m128 u = _mm_or_ps(_mm_and_ps(useX, x), _mm_andnot_ps(useX, y));
+    const __m128 v = _mm_or_ps(_mm_and_ps(useX, y), _mm_andnot_ps(useX, x));
+
+    // negating is flipping the sign bit, same as the scalar -u and -2.0f * v
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    const __m128 negU = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(h, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+    const __m128 negV = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(h, _mm_set1_epi32(2)), _mm_set1_epi32(2)));
+    return _mm_add_ps(_mm_xor_ps(u, _mm_and_ps(negU, sign)),
+                      _mm_xor_ps(_mm_mul_ps(_mm_set1_ps(2.0f), v), _mm_and_ps(negV, sign)));
+}
+
+/**
+ * Contribution of one simplex corner of 4 lanes
+ */
+static inline __m128 corner4(__m128i hash, __m128 x, __m128 y) {
+    __m128 t = _mm_sub_ps(_mm_sub_ps(_mm_set1_ps(0.5f), _mm_mul_ps(x, x)), _mm_mul_ps(y, y));
+    // !(t < 0) like the scalar branch
+    const __m128 inside = _mm_cmpnlt_ps(t, _mm_setzero_ps());
+    t = _mm_mul_ps(t, t);
+    return _mm_and_ps(inside, _mm_mul_ps(_mm_mul_ps(t, t), grad4(hash, x, y)));
+}
+
+/**
+ * 2D Perlin simplex noise of 4 lanes, the same operations in the same order as noise(x, y)
+ */
+static __m128 noise4(const uint8_t* perm, __m128 x, __m128 y) {
+    const __m128 F2 = _mm_set1_ps(0.366025403f);
+    const __m128 G2 = _mm_set1_ps(0.211324865f);
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    const __m128 s = _mm_mul_ps(_mm_add_ps(x, y), F2);
+    const __m128i i = fastfloor4(_mm_add_ps(x, s));
+    const __m128i j = fastfloor4(_mm_add_ps(y, s));
+
+    const __m128 t = _mm_mul_ps(_mm_cvtepi32_ps(_mm_add_epi32(i, j)), G2);
+    const __m128 x0 = _mm_sub_ps(x, _mm_sub_ps(_mm_cvtepi32_ps(i), t));
+    const __m128 y0 = _mm_sub_ps(y, _mm_sub_ps(_mm_cvtepi32_ps(j), t));
+
+    const __m128 lower = _mm_cmpgt_ps(x0, y0);
+    const __m128 x1 = _mm_add_ps(_mm_sub_ps(x0, _mm_and_ps(lower, one)), G2);
+    const __m128 y1 = _mm_add_ps(_mm_sub_ps(y0, _mm_andnot_ps(lower, one)), G2);
+    const __m128 x2 = _mm_add_ps(_mm_sub_ps(x0, one), _mm_set1_ps(2.0f * 0.211324865f));
+    const __m128 y2 = _mm_add_ps(_mm_sub_ps(y0, one), _mm_set1_ps(2.0f * 0.211324865f));
+
+    // the permutation table is looked up per lane, there is no byte gather in SSE
+    alignas(16) int32_t is[4], js[4], lowers[4];
+    alignas(16) int32_t gi0[4], gi1[4], gi2[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(is), i);
+    _mm_store_si128(reinterpret_cast<__m128i*>(js), j);
+    _mm_store_si128(reinterpret_cast<__m128i*>(lowers), _mm_castps_si128(lower));
+    for (int lane = 0; lane < 4; lane++) {
+        const int32_t i1 = lowers[lane] ? 1 : 0;
+        gi0[lane] = perm[static_cast<uint8_t>(is[lane] + perm[static_cast<uint8_t>(js[lane])])];
+        gi1[lane] = perm[static_cast<uint8_t>(is[lane] + i1 + perm[static_cast<uint8_t>(js[lane] + 1 - i1)])];
+        gi2[lane] = perm[static_cast<uint8_t>(is[lane] + 1 + perm[static_cast<uint8_t>(js[lane] + 1)])];
+    }
+
+    const __m128 n0 = corner4(_mm_load_si128(reinterpret_cast<const __m128i*>(gi0)), x0, y0);
+    const __m128 n1 = corner4(_mm_load_si128(reinterpret_cast<const __m128i*>(gi1)), x1, y1);
+    const __m128 n2 = corner4(_mm_load_si128(reinterpret_cast<const __m128i*>(gi2)), x2, y2);
+
+    return _mm_mul_ps(_mm_set1_ps(45.23065f), _mm_add_ps(_mm_add_ps(n0, n1), n2));
+}
+#endif
+
+/**
+ * 2D Perlin simplex noise of many points, equal to calling noise(x[n], y[n]) for each of them
+ *
+ * @param[in]  x     float coordinates
+ * @param[in]  y     float coordinates
+ * @param[out] out   count noise values
+ * @param[in]  count number of points
+ */
+void SimplexNoise::noise(const float* x, const float* y, float* out, size_t count) const {
+    size_t n = 0;
+#if defined(__SSE2__)
+    for (; n + 4 <= count; n += 4) {
+        _mm_storeu_ps(out + n, noise4(mPerm, _mm_loadu_ps(x + n), _mm_loadu_ps(y + n)));
+    }
+#endif
+    for (; n < count; n++) {
+        out[n] = noise(x[n], y[n]);
+    }
+}
+
 
 /**
  * 3D Perlin simplex noise
@@ -299,7 +439,7 @@ float SimplexNoise::noise(float x, float y) {
  *
  * @return Noise value in the range[-1; 1], value of 0 on all integer coordinates.
  */
-float SimplexNoise::noise(float x, float y, float z) {
+float SimplexNoise::noise(float x, float y, float z) const {
     float n0, n1, n2, n3; // Noise contributions from the four corners
 
     // Skewing/Unskewing factors for 3D
@@ -447,6 +587,52 @@ float SimplexNoise::fractal(size_t octaves, float x, float y) const {
     return (output / denom);
 }
 
+/**
+ * Fractal/Fractional Brownian Motion (fBm) summation of 2D Perlin Simplex noise over a grid,
+ * equal to out[row * width + column] = fractal(octaves, xs[column], ys[row])
+ *
+ * @param[in]  octaves  number of fraction of noise to sum
+ * @param[in]  xs       x float coordinates of the columns
+ * @param[in]  width    number of columns
+ * @param[in]  ys       y float coordinates of the rows
+ * @param[in]  height   number of rows
+ * @param[out] out      width * height noise values, row by row
+ */
+void SimplexNoise::fractal(size_t octaves, const float* xs, size_t width, const float* ys, size_t height, float* out) const {
+    const size_t count = width * height;
+    std::vector<float> x(count), y(count), octave(count);
+
+    for (size_t n = 0; n < count; n++) {
+        out[n] = 0.f;
+    }
+
+    float denom  = 0.f;
+    float frequency = mFrequency;
+    float amplitude = mAmplitude;
+
+    for (size_t i = 0; i < octaves; i++) {
+        for (size_t row = 0; row < height; row++) {
+            for (size_t column = 0; column < width; column++) {
+                x[row * width + column] = xs[column] * frequency;
+                y[row * width + column] = ys[row] * frequency;
+            }
+        }
+        noise(x.data(), y.data(), octave.data(), count);
+
+        for (size_t n = 0; n < count; n++) {
+            out[n] += (amplitude * octave[n]);
+        }
+        denom += amplitude;
+
+        frequency *= mLacunarity;
+        amplitude *= mPersistence;
+    }
+
+    for (size_t n = 0; n < count; n++) {
+        out[n] = (out[n] / denom);
+    }
+}
+
 /**
  * Fractal/Fractional Brownian Motion (fBm) summation of 3D Perlin Simplex noise
  *
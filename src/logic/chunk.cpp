@@ -11,7 +11,36 @@
 
 #include "game/global.h"
 #include "logic/chunk.h"
+#include "logic/map.h"
 #include "game/gamemath.hpp"
+#include "game/profiler.h"
+#include "game/deltalog.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+
+namespace
+{
+  // FNV-1a, only compared against hashes of the same chunk
+  uint64_t hashBytes(const uint8_t* data, size_t size)
+  {
+    uint64_t result = 0xcbf29ce484222325ull;
+    for (auto i = 0u; i < size; i++)
+    {
+      result = (result ^ data[i]) * 0x100000001b3ull;
+    }
+    return result;
+  }
+
+  uint32_t entityId(game::EntityVariant& entity)
+  {
+    return game::getEntityPtr<Entity>(entity)->getId();
+  }
+}
+
+Chunk::Stats Chunk::stats;
+std::atomic<uint64_t> Chunk::s_NextRevision { 1 };
 
 Chunk::Chunk(int x, int y, Map* map) : m_pos({x, y}), m_Map(map)
 {
@@ -19,10 +48,39 @@ Chunk::Chunk(int x, int y, Map* map) : m_pos({x, y}), m_Map(map)
 }
 
 Chunk::~Chunk()
+{
+  joinThreads();
+
+  if (!m_Flushed)
+  {
+    save();
+  }
+}
+
+void Chunk::flush()
+{
+  joinThreads();
+  save();
+  m_Flushed = true;
+}
+
+void Chunk::autosave()
 {
   joinThreads();
   m_saveThread = std::thread(&Chunk::save, this);
+}
+
+void Chunk::saveFull()
+{
   joinThreads();
+
+  Data temp;
+  {
+    std::scoped_lock lock(m_DataMutex);
+    temp = m_Data;
+  }
+  // m_Saved stays, the Overview already shows tiles the generator made
+  writeSnapshot(temp, summarize(temp));
 }
 
 game::vec2<int> Chunk::getPos() const
@@ -40,21 +98,51 @@ void Chunk::setPos(game::vec2<int> pos)
   // make sure no one is accessing Data at the moment
   joinThreads();
 
-  // on start no m_Data is in m_tilesets...
-  if (!m_Data.m_Tilesets.empty())
-  {
-    save();
-  }
+  // cheap if nothing changed, see save()
+  save();
 
   this->m_pos = pos;
+  m_Flushed = false;
 
   m_reloadThread = std::thread(&Chunk::reload, this);
 }
 
+std::string Chunk::filePath(game::vec2<int> pos)
+{
+  return chunkFolder + std::to_string(pos[0]) + "." + std::to_string(pos[1]) + ".tdat";
+}
+
+std::string Chunk::filePath() const
+{
+  return filePath(m_pos);
+}
+
+Chunk::SavedState Chunk::summarize(Data& data)
+{
+  SavedState result;
+  filesystem::BufferWriter ar;
+  ar.version = Data::version;
+  
+  ar(data.m_GameLayer, data.m_Tilesets);
+  result.staticHash = hashBytes(ar.buffer().data(), ar.buffer().size());
+  result.snapshotBytes = ar.buffer().size();
+  
+  for (auto& entity : data.m_Entities)
+  {
+    ar.clear();
+    ar(entity);
+    result.entityHashes[entityId(entity)] = hashBytes(ar.buffer().data(), ar.buffer().size());
+    result.snapshotBytes += ar.buffer().size();
+  }
+  
+  return result;
+}
+
 void Chunk::save()
 {
-  // get unique path
-  std::string path = chunkFolder + std::to_string(m_pos[0]) + "." + std::to_string(m_pos[1]);
+  PROFILE_ZONE("Chunk::save");
+
+  std::string path = filePath();
 
   Data temp;
 
@@ -63,50 +151,192 @@ void Chunk::save()
     std::scoped_lock lock(m_DataMutex);
     temp = m_Data;
   }
+  
+  auto current = summarize(temp);
+  
+  // tiles and game layer only go into full saves
+  if (current.staticHash == m_Saved.staticHash)
+  {
+    EntityDelta delta;
+    for (auto& entity : temp.m_Entities)
+    {
+      auto saved = m_Saved.entityHashes.find(entityId(entity));
+      if (saved == m_Saved.entityHashes.end() || saved->second != current.entityHashes[entityId(entity)])
+      {
+        delta.changed.push_back(entity);
+      }
+    }
+    for (const auto& saved : m_Saved.entityHashes)
+    {
+      if (current.entityHashes.count(saved.first) == 0)
+      {
+        delta.removed.push_back(saved.first);
+      }
+    }
+    
+    if (delta.changed.empty() && delta.removed.empty())
+    {
+      return;
+    }
+    
+    filesystem::BufferWriter ar;
+    ar.version = Data::version;
+    ar(delta);
+    auto logBytes = m_Saved.logBytes + deltalog::recordHeaderSize + ar.buffer().size();
+    
+    // past that, loading would read more log than snapshot. Generated chunks have no snapshot to log against
+    if (m_Saved.snapshotId != 0 && logBytes <= current.snapshotBytes && deltalog::append(path + ".log", m_Saved.snapshotId, ar.buffer()))
+    {
+      current.snapshotId = m_Saved.snapshotId;
+      current.logBytes = logBytes;
+      m_Saved = std::move(current);
+      stats.deltaSaves++;
+      return;
+    }
+  }
+
+  writeSnapshot(temp, std::move(current));
+}
 
-  // write m_Data into .tdat file
-  filesystem::writeStruct(path + ".tdat", temp);
+void Chunk::writeSnapshot(Data& data, SavedState current)
+{
+  std::string path = filePath();
+
+  // full save, the log starts over
+  data.m_SnapshotId = m_Saved.snapshotId + 1;
+  if (filesystem::writeStruct(path, data, m_Map->getChunkCodec()))
+  {
+    deltalog::clear(path + ".log");
+    
+    if (current.staticHash != m_Saved.staticHash)
+    {
+      m_Map->getOverview().update(m_pos, data);
+    }
+    
+    current.snapshotId = data.m_SnapshotId;
+    m_Saved = std::move(current);
+  }
+  stats.saves++;
 }
 
-void Chunk::load()
+bool Chunk::load()
 {
-  // get unique path
-  std::string path = chunkFolder + std::to_string(m_pos[0]) + "." + std::to_string(m_pos[1]);
+  PROFILE_ZONE("Chunk::load");
+
+  std::string path = filePath();
 
   Data temp;
 
   // read m_tilesets from .tdat file
-  filesystem::readStruct(path + ".tdat", temp);
+  if (!filesystem::readStruct(path, temp))
+  {
+    // keep what is left of a damaged file, the chunk gets generated again
+    std::error_code error;
+    if (std::filesystem::exists(path, error))
+    {
+      std::filesystem::rename(path, path + ".damaged", error);
+      printf("[CHUNK] %s is damaged, moved it to %s.damaged\n", path.c_str(), path.c_str());
+    }
+    return false;
+  }
+  
+  std::vector<std::vector<uint8_t>> records;
+  auto logBytes = deltalog::read(path + ".log", temp.m_SnapshotId, records);
+  
+  for (const auto& record : records)
+  {
+    EntityDelta delta;
+    filesystem::SpanReader ar(record);
+    ar.version = Data::version;
+    ar(delta);
+    if (ar.failed())
+    {
+      break;
+    }
+    
+    auto& entities = temp.m_Entities;
+    for (auto id : delta.removed)
+    {
+      entities.erase(std::remove_if(entities.begin(), entities.end(), [&](auto& entity) { return entityId(entity) == id; }), entities.end());
+    }
+    for (auto& changed : delta.changed)
+    {
+      auto found = std::find_if(entities.begin(), entities.end(), [&](auto& entity) { return entityId(entity) == entityId(changed); });
+      if (found != entities.end())
+      {
+        *found = std::move(changed);
+      }
+      else
+      {
+        entities.push_back(std::move(changed));
+      }
+    }
+  }
+  
+  m_Saved = summarize(temp);
+  m_Saved.snapshotId = temp.m_SnapshotId;
+  m_Saved.logBytes = logBytes;
+  
+  // maps saved before the overview existed fill it in as they are explored
+  if (!m_Map->getOverview().has(m_pos))
+  {
+    m_Map->getOverview().update(m_pos, temp);
+  }
+  
+  stats.loads++;
   // copy it threadsafe
   {
     std::scoped_lock lock(m_DataMutex);
-    m_Data = temp;
+    m_Data = std::move(temp);
   }
+  return true;
 }
 
 void Chunk::generate()
 {
-  // ✝ generator - 20.11.2018
+  PROFILE_ZONE("Chunk::generate");
+  
+  // runs on the reload thread, the tick only waits for the swap
+  Data temp;
+  if (m_Map->generateChunk(m_pos, temp))
+  {
+    stats.generatedCached++;
+  }
+  
+  // what the generator makes counts as saved, the chunk is only written once it differs
+  auto generated = summarize(temp);
+  
+  if (!m_Map->getOverview().has(m_pos))
+  {
+    m_Map->getOverview().update(m_pos, temp);
+  }
+  
+  {
+    std::scoped_lock lock(m_DataMutex);
+    m_Data.m_GameLayer = std::move(temp.m_GameLayer);
+    m_Data.m_Tilesets = std::move(temp.m_Tilesets);
+  }
+  m_Saved = std::move(generated);
+  stats.generated++;
 }
 
 void Chunk::reload()
 {
   {
     std::scoped_lock lock(m_DataMutex);
-    m_Data.m_Tilesets.clear();
-    m_Data.m_Entities.clear();
+    m_Data = Data();
   }
   
-  if (filesystem::fileExists(chunkFolder + std::to_string(m_pos[0]) + "." + std::to_string(m_pos[1]) + ".tdat"))
-  {
-    load();
-  }
-  else
+  // false for missing files as well
+  if (!load())
   {
+    // a log without its .tdat has nothing to apply to
+    deltalog::clear(filePath() + ".log");
+    
     generate();
-
-    m_saveThread = std::thread(&Chunk::save, this);
   }
+  
+  touch();
 }
 
 void Chunk::joinThreads()
@@ -165,3 +395,13 @@ void Chunk::unlockData()
 {
   m_DataMutex.unlock();
 }
+
+void Chunk::touch()
+{
+  m_Revision = s_NextRevision++;
+}
+
+uint64_t Chunk::getRevision() const
+{
+  return m_Revision;
+}
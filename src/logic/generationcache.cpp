@@ -0,0 +1,64 @@
+/*
+ *  FILENAME:      generationcache.cpp
+ *
+ *  DESCRIPTION:
+ *      The last generated chunks by seed and position
+ *
+ */
+
+#include "logic/generationcache.h"
+
+size_t GenerationCache::KeyHash::operator()(const Key& key) const
+{
+  uint64_t value = (static_cast<uint64_t>(static_cast<uint32_t>(key.x)) << 32 | static_cast<uint32_t>(key.y)) ^ (static_cast<uint64_t>(key.seed) * 0x9e3779b97f4a7c15ull);
+  value = (value ^ (value >> 31)) * 0xbf58476d1ce4e5b9ull;
+  return static_cast<size_t>(value ^ (value >> 29));
+}
+
+GenerationCache::GenerationCache(size_t capacity) : m_Capacity(capacity)
+{
+}
+
+bool GenerationCache::get(uint32_t seed, game::vec2<int> pos, Chunk::Data& data)
+{
+  std::scoped_lock lock(m_Mutex);
+
+  auto found = m_Index.find(Key { seed, pos[0], pos[1] });
+  if (found == m_Index.end())
+  {
+    return false;
+  }
+
+  m_Entries.splice(m_Entries.begin(), m_Entries, found->second);
+  data.m_GameLayer = found->second->gameLayer;
+  data.m_Tilesets = found->second->tilesets;
+  return true;
+}
+
+void GenerationCache::put(uint32_t seed, game::vec2<int> pos, const Chunk::Data& data)
+{
+  std::scoped_lock lock(m_Mutex);
+
+  Key key { seed, pos[0], pos[1] };
+  auto found = m_Index.find(key);
+  if (found != m_Index.end())
+  {
+    m_Entries.splice(m_Entries.begin(), m_Entries, found->second);
+    return;
+  }
+
+  m_Entries.push_front(Entry { key, data.m_GameLayer, data.m_Tilesets });
+  m_Index[key] = m_Entries.begin();
+
+  if (m_Entries.size() > m_Capacity)
+  {
+    m_Index.erase(m_Entries.back().key);
+    m_Entries.pop_back();
+  }
+}
+
+size_t GenerationCache::size()
+{
+  std::scoped_lock lock(m_Mutex);
+  return m_Entries.size();
+}
@@ -0,0 +1,103 @@
+/*
+ *  FILENAME:      generator.cpp
+ *
+ *  DESCRIPTION:
+ *      Deterministic terrain for chunks that were never saved, from fractal simplex noise
+ *
+ */
+
+#include <array>
+
+#include "logic/generator.h"
+#include "game/gamemath.hpp"
+
+namespace
+{
+  // small integer hash (lowbias32), decorrelates neighbouring cells and seeds
+  uint32_t mix(uint32_t value)
+  {
+    value ^= value >> 16;
+    value *= 0x7feb352du;
+    value ^= value >> 15;
+    value *= 0x846ca68bu;
+    value ^= value >> 16;
+    return value;
+  }
+
+  uint32_t cellHash(uint32_t seed, int x, int y)
+  {
+    return mix(seed ^ mix(static_cast<uint32_t>(x) ^ mix(static_cast<uint32_t>(y))));
+  }
+}
+
+Generator::Generator(uint32_t seed, unsigned groundTileset, unsigned rockTileset) :
+  Generator(seed, groundTileset, rockTileset, Settings())
+{
+}
+
+Generator::Generator(uint32_t seed, unsigned groundTileset, unsigned rockTileset, const Settings& settings) :
+  m_Seed(seed),
+  m_GroundTileset(groundTileset),
+  m_RockTileset(rockTileset),
+  m_Settings(settings),
+  m_Noise(seed, 1.f / settings.featureSize)
+{
+}
+
+uint32_t Generator::getSeed() const
+{
+  return m_Seed;
+}
+
+float Generator::height(float x, float y) const
+{
+  return m_Noise.fractal(m_Settings.octaves, x, y);
+}
+
+void Generator::generate(game::vec2<int> chunkPos, Chunk::Data& data) const
+{
+  constexpr auto size = game::math::chunkSize;
+  auto origin = game::math::chunkToEntityPos(chunkPos);
+  auto firstX = chunkPos[0] * size;
+  auto firstY = chunkPos[1] * size;
+
+  // sampled at the cell centers, the whole chunk in one batch
+  std::array<float, size> xs;
+  std::array<float, size> ys;
+  for (auto i = 0; i < size; i++)
+  {
+    xs[i] = origin[0] + i + .5f;
+    ys[i] = origin[1] + i + .5f;
+  }
+  std::array<float, size * size> heights;
+  m_Noise.fractal(m_Settings.octaves, xs.data(), size, ys.data(), size, heights.data());
+
+  TileLayer ground;
+  TileLayer rock;
+  data.m_GameLayer = { };
+
+  for (auto y = 0; y < size; y++)
+  {
+    for (auto x = 0; x < size; x++)
+    {
+      auto h = heights[y * size + x];
+      auto hash = cellHash(m_Seed, firstX + x, firstY + y);
+
+      auto variant = static_cast<char>(1 + hash % m_Settings.groundVariants);
+      ground.set(x, y, Tile(variant, 90.f * ((hash >> 8) % 4)));
+
+      if (h > m_Settings.rockLevel)
+      {
+        rock.set(x, y, Tile(1, 90.f * ((hash >> 10) % 4)));
+        data.m_GameLayer.set(x, y, rockId);
+      }
+    }
+  }
+
+  data.m_Tilesets.clear();
+  data.m_Tilesets.push_back(Tileset(m_GroundTileset, 0.f, 0.f, 1.f, ground));
+  if (!rock.empty())
+  {
+    data.m_Tilesets.push_back(Tileset(m_RockTileset, 0.f, 0.f, 1.f, rock));
+  }
+}
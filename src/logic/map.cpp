@@ -13,12 +13,19 @@
 
 #include "logic/map.h"
 #include "game/gamemath.hpp"
+#include "game/profiler.h"
 
 #include <memory> //std::shared_ptr, std::make_shared
 #include <array>  //std::array, std::make_pair
 #include <vector> //std::vector
 #include <stack>  //std::stack
+#include <algorithm> //std::min, std::max, std::sort
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <random>
 #include <iostream>
+#include <filesystem>
 
 int mod(int a, int b)
 {
@@ -27,43 +34,250 @@ int mod(int a, int b)
 
 Map::Map() 
 {
-  if (filesystem::fileExists(m_MapFolder + "data.dat"))
+  std::string path = getDataFilePath();
+  
+  if (filesystem::readStruct(path, m_Data))
   {
-    filesystem::readStruct(m_MapFolder + "data.dat", m_Data);
+    m_LoadResult = LoadResult::Loaded;
   }
   else
   {
+    // the entity count, tileset names and seed can't be recovered from the chunks, starting over would
+    // hand out ids already in use and generate chunks that don't fit the saved ones. Keep the file for repairs,
+    // until someone restored or removed it the map isn't new either
+    std::error_code error;
+    if (std::filesystem::exists(path, error))
+    {
+      std::filesystem::rename(path, path + ".damaged", error);
+      m_LoadResult = LoadResult::Damaged;
+    }
+    else if (std::filesystem::exists(path + ".damaged", error))
+    {
+      m_LoadResult = LoadResult::Damaged;
+    }
+    else
+    {
+      m_LoadResult = LoadResult::Created;
+    }
+    
+    m_Data = Data();
     init();
+    
+    // nothing of a damaged map is written, see getLoadResult
+    m_Flushed = m_LoadResult == LoadResult::Damaged;
   }
+  
+  m_Overview.setCodec(m_Data.m_ChunkCodec);
+  createGenerator();
+}
+
+Map::LoadResult Map::getLoadResult() const
+{
+  return m_LoadResult;
+}
+
+std::string Map::getDataFilePath() const
+{
+  return m_MapFolder + "data.dat";
+}
+
+void Map::createGenerator()
+{
+  m_Generator.emplace(m_Data.m_Seed, getTilesetId("Gras"), getTilesetId("Stein"));
 }
 
 void Map::init() 
 {
   m_Data.m_EntityCount = 1;
+  m_Data.m_ChunkCodec = compression::Codec::LZ4;
+  m_Data.m_Seed = std::random_device()();
 }
 
 
 Map::~Map() 
 {
-  filesystem::writeStruct(m_MapFolder + "data.dat", m_Data);
+  if (!m_Flushed)
+  {
+    flush();
+  }
+  
+  m_Chunks.clear();
+  m_unusedChunks = { };
+}
+
+std::vector<Chunk*> Map::loadedChunks()
+{
+  std::vector<Chunk*> chunks;
+  for (auto& chunkEntry : m_Chunks)
+  {
+    for (auto& column : chunkEntry.second)
+    {
+      for (auto& chunkLock : column)
+      {
+        chunks.push_back(chunkLock.get());
+      }
+    }
+  }
+  for (auto unused = m_unusedChunks; !unused.empty(); unused.pop())
+  {
+    chunks.push_back(unused.top().get());
+  }
+  
+  // players share chunks
+  std::sort(chunks.begin(), chunks.end());
+  chunks.erase(std::unique(chunks.begin(), chunks.end()), chunks.end());
+  
+  return chunks;
+}
+
+void Map::autosave()
+{
+  PROFILE_ZONE("Map::autosave");
+  
+  if (m_LoadResult == LoadResult::Damaged)
+  {
+    return;
+  }
+  
+  for (auto* chunk : loadedChunks())
+  {
+    chunk->autosave();
+  }
+  
+  // small, and entity ids handed out since the last save must not be handed out again after a crash
+  Data temp;
+  {
+    std::scoped_lock lock(m_DataMutex);
+    temp = m_Data;
+  }
+  filesystem::writeStruct(m_MapFolder + "data.dat", temp);
+  
+  // the chunk saves just started can still change it, those changes go with the next save
+  m_Overview.save();
+}
+
+Map::FlushResult Map::flush()
+{
+  PROFILE_ZONE("Map::flush");
+  auto start = std::chrono::steady_clock::now();
+  
+  if (m_LoadResult == LoadResult::Damaged)
+  {
+    return FlushResult { 0, 0.f };
+  }
+  
+  auto chunks = loadedChunks();
+  
+  // writes wait on the disk more than on the cpu, so use a few more threads than cores
+  auto threadCount = std::min<size_t>(chunks.size(), std::max(4u, std::thread::hardware_concurrency()));
+  std::atomic<size_t> next { 0 };
+  std::vector<std::thread> workers;
+  
+  for (auto i = 0u; i < threadCount; i++)
+  {
+    workers.emplace_back(
+      [&]() -> void
+      {
+        for (auto index = next++; index < chunks.size(); index = next++)
+        {
+          chunks[index]->flush();
+        }
+      }
+    );
+  }
+  
+  Data temp;
+  {
+    std::scoped_lock lock(m_DataMutex);
+    temp = m_Data;
+  }
+  filesystem::writeStruct(m_MapFolder + "data.dat", temp);
+  
+  for (auto& worker : workers)
+  {
+    worker.join();
+  }
+  
+  // after the chunks, their last saves update it
+  m_Overview.save();
+  
+  // every file is synced before its rename, the renames themselves once per directory for all of them
+  for (const auto& dir : { m_MapFolder, m_MapFolder + "chunks/", m_MapFolder + "overview/" })
+  {
+    filesystem::syncDirectory(dir);
+  }
+  
+  m_Flushed = true;
+  
+  return { chunks.size(), std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count() };
 }
 
 unsigned int Map::getNextEntityId() 
 {
-  std::scoped_lock(m_DataMutex);
+  std::scoped_lock lock(m_DataMutex);
   return m_Data.m_EntityCount++;
 }
 
 unsigned int Map::addNewTileset(const std::string& imgName) 
 {
-  std::scoped_lock(m_DataMutex);
+  std::scoped_lock lock(m_DataMutex);
   m_Data.m_TileSetImgs.push_back(imgName);
   return m_Data.m_TileSetImgs.size() - 1;
 }
 
+unsigned int Map::getTilesetId(const std::string& imgName)
+{
+  std::scoped_lock lock(m_DataMutex);
+  auto found = std::find(m_Data.m_TileSetImgs.begin(), m_Data.m_TileSetImgs.end(), imgName);
+  if (found != m_Data.m_TileSetImgs.end())
+  {
+    return found - m_Data.m_TileSetImgs.begin();
+  }
+  m_Data.m_TileSetImgs.push_back(imgName);
+  return m_Data.m_TileSetImgs.size() - 1;
+}
+
+const Generator& Map::getGenerator() const
+{
+  return *m_Generator;
+}
+
+bool Map::generateChunk(game::vec2<int> pos, Chunk::Data& data)
+{
+  auto seed = m_Generator->getSeed();
+  if (m_GenerationCache.get(seed, pos, data))
+  {
+    return true;
+  }
+  
+  m_Generator->generate(pos, data);
+  m_GenerationCache.put(seed, pos, data);
+  return false;
+}
+
+Overview& Map::getOverview()
+{
+  return m_Overview;
+}
+
+uint32_t Map::getSeed()
+{
+  std::scoped_lock lock(m_DataMutex);
+  return m_Data.m_Seed;
+}
+
+void Map::setSeed(uint32_t seed)
+{
+  {
+    std::scoped_lock lock(m_DataMutex);
+    m_Data.m_Seed = seed;
+  }
+  createGenerator();
+}
+
 std::optional<std::string> Map::getTilesetImgName(unsigned id) 
 {
-  std::scoped_lock(m_DataMutex);
+  std::scoped_lock lock(m_DataMutex);
   if (m_Data.m_TileSetImgs.size() > id)
   {
     return { m_Data.m_TileSetImgs[id] };
@@ -75,6 +289,19 @@ std::optional<std::string> Map::getTilesetImgName(unsigned id)
 }
 
 
+compression::Codec Map::getChunkCodec()
+{
+  std::scoped_lock lock(m_DataMutex);
+  return m_Data.m_ChunkCodec;
+}
+
+void Map::setChunkCodec(compression::Codec codec)
+{
+  std::scoped_lock lock(m_DataMutex);
+  m_Data.m_ChunkCodec = codec;
+  m_Overview.setCodec(codec);
+}
+
 void Map::tick()
 {
   std::stack<SharedEntityPtr> unusedEntites;
@@ -106,6 +333,8 @@ void Map::tick()
 
 void Map::tickChunks()
 {
+  PROFILE_ZONE("Map::tickChunks");
+
   for (auto& chunkEntry : m_Chunks)
   {
     auto& chunkPtrArray = chunkEntry.second;
@@ -340,14 +569,108 @@ char Map::getGamelayerIdAt(game::vec2<float> pos)
     auto* chunk = chunkLock->get();
     auto tilePos = pos - game::math::chunkToEntityPos(chunk->getPos());
 
-    auto result = chunkLock->get()->m_Data.m_GameLayer[static_cast<int>(tilePos[0])][static_cast<int>(tilePos[1])];
-
-    return result;
+    return chunk->m_Data.m_GameLayer.get(static_cast<unsigned>(tilePos[0]), static_cast<unsigned>(tilePos[1]));
   }
   
   return 0;
 }
 
+bool Map::anyGamelayerInBox(char id, game::vec2<float> boxTopLeft, game::vec2<float> size)
+{
+  // same cells as testing the corners cell by cell, plus everything in between
+  auto left   = static_cast<int>(floor(boxTopLeft[0]));
+  auto top    = static_cast<int>(floor(boxTopLeft[1]));
+  auto right  = static_cast<int>(floor(boxTopLeft[0] + size[0]));
+  auto bottom = static_cast<int>(floor(boxTopLeft[1] + size[1]));
+  
+  auto topLeftChunkPos = game::math::entityToChunkPos(boxTopLeft);
+  auto bottomRightChunkPos = game::math::entityToChunkPos(boxTopLeft + size);
+  
+  for (auto x = topLeftChunkPos[0]; x <= bottomRightChunkPos[0]; x++)
+  {
+    for (auto y = topLeftChunkPos[1]; y <= bottomRightChunkPos[1]; y++)
+    {
+      auto chunkLock = getIdealChunk(game::vec2<int>(x, y));
+      if (!chunkLock)
+      {
+        continue;
+      }
+      
+      auto originX = x * game::math::chunkSize;
+      auto originY = y * game::math::chunkSize;
+      auto box = Chunk::cellMask::rect(left - originX, top - originY, right - left + 1, bottom - top + 1);
+      
+      if (chunkLock->get()->m_Data.m_GameLayer.mask(id).intersects(box))
+      {
+        return true;
+      }
+    }
+  }
+  
+  return false;
+}
+
+std::optional<int> Map::firstGamelayerInRow(char id, int row, int fromX, int toX)
+{
+  return firstGamelayerInLine(id, row, fromX, toX, true);
+}
+
+std::optional<int> Map::firstGamelayerInColumn(char id, int column, int fromY, int toY)
+{
+  return firstGamelayerInLine(id, column, fromY, toY, false);
+}
+
+std::optional<int> Map::firstGamelayerInLine(char id, int line, int from, int to, bool isRow)
+{
+  const int size = game::math::chunkSize;
+  const int step = from <= to ? 1 : -1;
+  
+  auto localLine = mod(line, size);
+  auto lineChunk = (line - localLine) / size;
+  
+  // one chunk per iteration
+  for (auto cell = from; ; )
+  {
+    auto chunkStart = cell - mod(cell, size);
+    auto last = step > 0 ? std::min(to, chunkStart + size - 1) : std::max(to, chunkStart);
+    
+    auto chunkPos = isRow ? game::vec2<int>(chunkStart / size, lineChunk) : game::vec2<int>(lineChunk, chunkStart / size);
+    auto chunkLock = getIdealChunk(chunkPos);
+    if (chunkLock)
+    {
+      auto mask = chunkLock->get()->m_Data.m_GameLayer.mask(id);
+      uint64_t bits = isRow ? mask.row(localLine) : mask.column(localLine);
+      
+      auto low  = std::min(cell, last) - chunkStart;
+      auto high = std::max(cell, last) - chunkStart;
+      bits &= (high == 63 ? ~uint64_t(0) : (uint64_t(1) << (high + 1)) - 1) & ~((uint64_t(1) << low) - 1);
+      
+      if (bits != 0)
+      {
+        return chunkStart + (step > 0 ? __builtin_ctzll(bits) : 63 - __builtin_clzll(bits));
+      }
+    }
+    
+    if (last == to)
+    {
+      return { };
+    }
+    cell = last + step;
+  }
+}
+
+std::optional<Chunk::cellMask> Map::getGamelayerMask(game::vec2<int> chunkPos, char id)
+{
+  auto chunkLock = getIdealChunk(chunkPos);
+  
+  if (chunkLock)
+  {
+    return chunkLock->get()->m_Data.m_GameLayer.mask(id);
+  }
+  
+  return { };
+}
+
 size_t Map::getLoadingDistance()
 {
     return loadingDistance;
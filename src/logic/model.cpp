@@ -18,6 +18,7 @@
 #include <iostream>
 
 #include "logic/model.h"
+#include "game/profiler.h"
 
 Model::Model()
 {
@@ -49,6 +50,8 @@ Map* Model::getMap()
 
 void Model::tick()
 {
+  PROFILE_ZONE("Model::tick");
+
   m_Map->tick();
   
   handleMapCollision();
@@ -64,25 +67,15 @@ void Model::handleMapCollision()
         -entity.getSize()[0] * entity.getAnchor()[0], 
         -entity.getSize()[1] * entity.getAnchor()[1]
       };
-      auto entityTopRight = entity.getPos() + game::vec2<float> {
-        entity.getSize()[0] * entity.getAnchor()[0], 
-        -entity.getSize()[1] * entity.getAnchor()[1]
-      };
-      auto entityBottomLeft = entity.getPos() + game::vec2<float> {
-        -entity.getSize()[0] * entity.getAnchor()[0], 
-        entity.getSize()[1] * entity.getAnchor()[1]
-      };
       auto entityBottomRight = entity.getPos() + game::vec2<float> {
         entity.getSize()[0] * entity.getAnchor()[0], 
         entity.getSize()[1] * entity.getAnchor()[1]
       };
       
-      bool topLeftCollision = m_Map->getGamelayerIdAt(entityTopLeft) == 1;
-      bool topRightCollision = m_Map->getGamelayerIdAt(entityTopRight) == 1;
-      bool bottomLeftCollision = m_Map->getGamelayerIdAt(entityBottomLeft) == 1;
-      bool bottomRightCollision = m_Map->getGamelayerIdAt(entityBottomRight) == 1;
+      // one mask test per chunk the entity overlaps instead of a chunk lookup per corner
+      bool collision = m_Map->anyGamelayerInBox(1, entityTopLeft, entityBottomRight - entityTopLeft);
       
-      if (topLeftCollision || topRightCollision || bottomLeftCollision || bottomRightCollision)
+      if (collision)
       {
         
       }
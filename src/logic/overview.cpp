@@ -0,0 +1,281 @@
+/*
+ *  FILENAME:      overview.cpp
+ *
+ *  DESCRIPTION:
+ *      Downsampled pyramid of the map's tiles for zoomed out views
+ *
+ */
+
+#include <algorithm>
+#include <filesystem>
+
+#include "logic/overview.h"
+
+static_assert(game::math::chunkSize % (Overview::levelFactor * Overview::levelFactor) == 0, "every level needs whole texels per chunk");
+
+Overview::Texel Overview::encode(unsigned tilesetId, char index)
+{
+  if (index == 0)
+  {
+    return 0;
+  }
+  return (tilesetId + 1) << 8 | static_cast<unsigned char>(index);
+}
+
+unsigned Overview::tilesetId(Texel texel)
+{
+  return (texel >> 8) - 1;
+}
+
+unsigned char Overview::tileIndex(Texel texel)
+{
+  return static_cast<unsigned char>(texel & 0xff);
+}
+
+unsigned Overview::levelSize(unsigned level)
+{
+  auto size = regionTiles;
+  for (auto i = 1u; i < level; i++)
+  {
+    size /= levelFactor;
+  }
+  return size;
+}
+
+game::vec2<int> Overview::chunkToRegion(game::vec2<int> chunkPos)
+{
+  // rounds down for negative positions as well
+  auto floorDiv = [](int value) { return value >= 0 ? value / regionChunks : (value + 1) / regionChunks - 1; };
+  return { floorDiv(chunkPos[0]), floorDiv(chunkPos[1]) };
+}
+
+size_t Overview::KeyHash::operator()(const game::vec2<int>& pos) const
+{
+  uint64_t value = static_cast<uint64_t>(static_cast<uint32_t>(pos[0])) << 32 | static_cast<uint32_t>(pos[1]);
+  value = (value ^ (value >> 31)) * 0xbf58476d1ce4e5b9ull;
+  return static_cast<size_t>(value ^ (value >> 29));
+}
+
+Overview::Overview(const std::string& folder, size_t capacity) : m_Folder(folder), m_Capacity(std::max<size_t>(capacity, 1))
+{
+}
+
+std::string Overview::filePath(game::vec2<int> region) const
+{
+  return m_Folder + std::to_string(region[0]) + "." + std::to_string(region[1]) + ".odat";
+}
+
+void Overview::setCodec(compression::Codec codec)
+{
+  std::scoped_lock lock(m_Mutex);
+  m_Codec = codec;
+}
+
+Overview::Region& Overview::region(game::vec2<int> pos)
+{
+  auto found = m_Index.find(pos);
+  if (found != m_Index.end())
+  {
+    m_Regions.splice(m_Regions.begin(), m_Regions, found->second);
+    return *found->second;
+  }
+
+  Region loaded;
+  loaded.pos = pos;
+
+  // a region read back after its eviction holds what it held before, textures made from it stay valid
+  auto known = m_Revisions.find(pos);
+  if (known != m_Revisions.end())
+  {
+    loaded.revision = known->second;
+  }
+  else
+  {
+    loaded.revision = m_NextRevision++;
+    m_Revisions[pos] = loaded.revision;
+  }
+  for (auto level = 1u; level <= levelCount; level++)
+  {
+    loaded.levels.emplace_back(static_cast<size_t>(levelSize(level)) * levelSize(level), 0);
+  }
+
+  // a missing region stays in memory empty, so it isn't looked for on disk every frame
+  Data data;
+  if (filesystem::readStruct(filePath(pos), data) && data.m_Texels.size() == loaded.levels[0].size())
+  {
+    loaded.present = data.m_Present;
+    loaded.levels[0] = std::move(data.m_Texels);
+    for (auto level = 2u; level <= levelCount; level++)
+    {
+      downsample(loaded, level, 0, 0, levelSize(level));
+    }
+  }
+
+  m_Regions.push_front(std::move(loaded));
+  m_Index[pos] = m_Regions.begin();
+
+  if (m_Regions.size() > m_Capacity)
+  {
+    auto& oldest = m_Regions.back();
+    if (oldest.dirty)
+    {
+      write(oldest);
+    }
+    // lost changes, the next load reads something else
+    if (oldest.dirty)
+    {
+      m_Revisions.erase(oldest.pos);
+    }
+    m_Index.erase(oldest.pos);
+    m_Regions.pop_back();
+  }
+
+  return m_Regions.front();
+}
+
+void Overview::downsample(Region& region, unsigned level, unsigned firstX, unsigned firstY, unsigned size)
+{
+  const auto& src = region.levels[level - 2];
+  auto& dst = region.levels[level - 1];
+  auto srcSize = levelSize(level - 1);
+  auto dstSize = levelSize(level);
+
+  std::array<Texel, levelFactor * levelFactor> block;
+  for (auto y = firstY; y < firstY + size; y++)
+  {
+    for (auto x = firstX; x < firstX + size; x++)
+    {
+      for (auto i = 0u; i < levelFactor; i++)
+      {
+        auto* row = &src[static_cast<size_t>(y * levelFactor + i) * srcSize + x * levelFactor];
+        std::copy(row, row + levelFactor, block.begin() + i * levelFactor);
+      }
+
+      // most common tile wins, ties go to the first one found
+      Texel best = 0;
+      auto bestCount = 0;
+      for (auto i = 0u; i < block.size(); i++)
+      {
+        if (block[i] == 0 || block[i] == best)
+        {
+          continue;
+        }
+        auto count = static_cast<int>(std::count(block.begin() + i, block.end(), block[i]));
+        if (count > bestCount)
+        {
+          best = block[i];
+          bestCount = count;
+        }
+      }
+      dst[static_cast<size_t>(y) * dstSize + x] = best;
+    }
+  }
+}
+
+void Overview::update(game::vec2<int> chunkPos, const Chunk::Data& data)
+{
+  constexpr auto size = game::math::chunkSize;
+
+  // later tilesets are drawn on top
+  std::array<Texel, size * size> texels { };
+  for (const auto& ts : data.m_Tilesets)
+  {
+    ts.tileData.for_each([&](unsigned x, unsigned y, const Tile& tile)
+    {
+      texels[y * size + x] = encode(ts.id, tile.index);
+    });
+  }
+
+  auto regionPos = chunkToRegion(chunkPos);
+  auto localX = chunkPos[0] - regionPos[0] * regionChunks;
+  auto localY = chunkPos[1] - regionPos[1] * regionChunks;
+
+  std::scoped_lock lock(m_Mutex);
+  auto& target = region(regionPos);
+
+  auto& first = target.levels[0];
+  for (auto y = 0; y < size; y++)
+  {
+    std::copy(&texels[y * size], &texels[y * size] + size, &first[static_cast<size_t>(localY * size + y) * regionTiles + localX * size]);
+  }
+
+  auto texelsPerChunk = static_cast<unsigned>(size);
+  for (auto level = 2u; level <= levelCount; level++)
+  {
+    texelsPerChunk /= levelFactor;
+    downsample(target, level, localX * texelsPerChunk, localY * texelsPerChunk, texelsPerChunk);
+  }
+
+  auto bit = static_cast<unsigned>(localY * regionChunks + localX);
+  target.present[bit / 64] |= uint64_t(1) << (bit % 64);
+  target.revision = m_NextRevision++;
+  m_Revisions[regionPos] = target.revision;
+  target.dirty = true;
+}
+
+bool Overview::has(game::vec2<int> chunkPos)
+{
+  auto regionPos = chunkToRegion(chunkPos);
+  auto bit = static_cast<unsigned>((chunkPos[1] - regionPos[1] * regionChunks) * regionChunks + chunkPos[0] - regionPos[0] * regionChunks);
+
+  std::scoped_lock lock(m_Mutex);
+  return (region(regionPos).present[bit / 64] >> (bit % 64) & 1) != 0;
+}
+
+bool Overview::getLevel(game::vec2<int> regionPos, unsigned level, std::vector<Texel>& texels, uint32_t& revision)
+{
+  if (level < 1 || level > levelCount)
+  {
+    return false;
+  }
+
+  std::scoped_lock lock(m_Mutex);
+  auto& found = region(regionPos);
+  revision = found.revision;
+
+  if (std::all_of(found.present.begin(), found.present.end(), [](uint64_t word) { return word == 0; }))
+  {
+    return false;
+  }
+  texels = found.levels[level - 1];
+  return true;
+}
+
+uint32_t Overview::getRevision(game::vec2<int> regionPos)
+{
+  std::scoped_lock lock(m_Mutex);
+  auto found = m_Revisions.find(regionPos);
+  return found != m_Revisions.end() ? found->second : 0;
+}
+
+bool Overview::isCached(game::vec2<int> regionPos)
+{
+  std::scoped_lock lock(m_Mutex);
+  return m_Index.count(regionPos) != 0;
+}
+
+void Overview::write(Region& region)
+{
+  std::error_code error;
+  std::filesystem::create_directories(m_Folder, error);
+
+  Data data;
+  data.m_Present = region.present;
+  data.m_Texels = region.levels[0];
+  if (filesystem::writeStruct(filePath(region.pos), data, m_Codec))
+  {
+    region.dirty = false;
+  }
+}
+
+void Overview::save()
+{
+  std::scoped_lock lock(m_Mutex);
+  for (auto& region : m_Regions)
+  {
+    if (region.dirty)
+    {
+      write(region);
+    }
+  }
+}
@@ -0,0 +1,108 @@
+/*
+ *  FILENAME:      tilemap.cpp
+ *
+ *  DESCRIPTION:
+ *      Encoding of a tileset's tileData into a small index texture and a CPU reference of the lookup done in tile.fs.glsl
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+
+#include "logic/tilemap.h"
+
+namespace tilemap
+{
+  uint64_t IndexMap::hash() const
+  {
+    // FNV-1a, only used to detect changed tile data
+    uint64_t result = 0xcbf29ce484222325ull ^ (static_cast<uint64_t>(w) << 32 | h);
+    for (auto texel : texels)
+    {
+      result = (result ^ texel) * 0x100000001b3ull;
+    }
+    return result;
+  }
+
+  void encode(const Tileset& ts, IndexMap& map)
+  {
+    map.w = TileLayer::size;
+    map.h = TileLayer::size;
+    map.texels.assign(static_cast<size_t>(map.w) * map.h * 4, 0);
+
+    ts.tileData.for_each([&](unsigned x, unsigned y, const Tile& tile)
+    {
+      auto* texel = &map.texels[(static_cast<size_t>(y) * map.w + x) * 4];
+
+      texel[0] = static_cast<uint8_t>(tile.index);
+      texel[1] = tile.turns;
+    });
+  }
+
+  std::optional<game::vec2<float>> atlasCoord(const IndexMap& map, game::vec2<float> uv)
+  {
+    if (map.w == 0 || map.h == 0)
+    {
+      return { };
+    }
+
+    float cellX = uv[0] * map.w;
+    float cellY = uv[1] * map.h;
+    int x = std::clamp(static_cast<int>(std::floor(cellX)), 0, static_cast<int>(map.w) - 1);
+    int y = std::clamp(static_cast<int>(std::floor(cellY)), 0, static_cast<int>(map.h) - 1);
+
+    const auto* texel = &map.texels[(static_cast<size_t>(y) * map.w + x) * 4];
+    unsigned index = texel[0];
+
+    if (index == 0)
+    {
+      return { };
+    }
+
+    float localX = cellX - x;
+    float localY = cellY - y;
+
+    // quarter turns clockwise
+    switch (texel[1])
+    {
+      case 1: std::tie(localX, localY) = std::make_tuple(localY, 1.f - localX); break;
+      case 2: std::tie(localX, localY) = std::make_tuple(1.f - localX, 1.f - localY); break;
+      case 3: std::tie(localX, localY) = std::make_tuple(1.f - localY, localX); break;
+    }
+
+    return game::vec2<float>(
+      (static_cast<float>(index % atlasCells) + localX) / atlasCells,
+      (static_cast<float>(index / atlasCells) + localY) / atlasCells
+    );
+  }
+
+  std::optional<game::vec2<float>> perTileAtlasCoord(const Tileset& ts, game::vec2<float> uv)
+  {
+    float cellY = uv[1] * TileLayer::size;
+    auto i = std::min<unsigned>(static_cast<unsigned>(std::max(0.f, cellY)), TileLayer::size - 1);
+
+    float cellX = uv[0] * TileLayer::size;
+    auto j = std::min<unsigned>(static_cast<unsigned>(std::max(0.f, cellX)), TileLayer::size - 1);
+
+    const Tile& tile = ts.tileData.get(j, i);
+    auto c = static_cast<unsigned char>(tile.index);
+    if (c == 0)
+    {
+      return { };
+    }
+
+    // the blit turns the tile clockwise about its center, so the source point is the target point turned back
+    float radians = tile.rot() * 3.14159265f / 180.f;
+    float dx = cellX - j - .5f;
+    float dy = cellY - i - .5f;
+    float localX = .5f + std::cos(radians) * dx + std::sin(radians) * dy;
+    float localY = .5f - std::sin(radians) * dx + std::cos(radians) * dy;
+
+    // source rect as Camera::getTile computes it for a blit with inset 0
+    return game::vec2<float>(
+      (static_cast<float>(c % atlasCells) + localX) / atlasCells,
+      (static_cast<float>(c / atlasCells) + localY) / atlasCells
+    );
+  }
+}
@@ -27,7 +27,10 @@ int main(int argc, char** argv)
   
   Controller ctrl;
 
-  ctrl.init(argc, argv);
+  if (!ctrl.init(argc, argv))
+  {
+    return EXIT_FAILURE;
+  }
     
   do{ }while(ctrl.tick());
 
@@ -0,0 +1,158 @@
+/*
+ *  FILENAME:      minimap.cpp
+ *
+ *  DESCRIPTION:
+ *      Overlay showing the chunks around a point at one texel per tile
+ *
+ */
+
+#include <algorithm>
+#include <climits>
+
+#include "renderer/minimap.h"
+#include "game/gamemath.hpp"
+
+Minimap::Minimap(Map* map, std::map<std::string, LODImage>* tilesetImgs, int radius)
+{
+  this->map = map;
+  this->tilesetImgs = tilesetImgs;
+  this->radius = radius;
+  size = (2*radius + 1) * game::math::chunkSize;
+
+  pixels.assign(static_cast<size_t>(size) * size * 4, 0);
+  slotRevisions.assign((2*radius + 1) * (2*radius + 1), 0);
+  center = vec2<int>(INT_MIN, INT_MIN);
+
+  image = GPU_CreateImage(size, size, GPU_FORMAT_RGBA);
+  if(image != NULL)
+  {
+    GPU_SetImageFilter(image, GPU_FILTER_NEAREST);
+    GPU_UpdateImageBytes(image, NULL, pixels.data(), size * 4);
+  }
+
+  //upper right corner, height follows the width
+  overlay = {image, .78f, .02f, .2f, -1.f, image != NULL};
+}
+
+Minimap::~Minimap()
+{
+  if(image != NULL)
+  {
+    GPU_FreeImage(image);
+  }
+}
+
+Overlay* Minimap::getOverlay()
+{
+  return &overlay;
+}
+
+void Minimap::drawChunk(const Chunk* chunk, int slotX, int slotY)
+{
+  constexpr unsigned chunkSize = game::math::chunkSize;
+  uint8_t* first = &pixels[(static_cast<size_t>(slotY) * chunkSize * size + slotX * chunkSize) * 4];
+
+  for(unsigned y = 0; y < chunkSize; y++)
+  {
+    std::fill(first + y * size * 4, first + (y * size + chunkSize) * 4, 0);
+  }
+  if(chunk == nullptr)
+  {
+    return;
+  }
+
+  const LODImage* tilesetImg = NULL;
+  const Tileset* ts = chunk->m_Data.m_Tilesets.empty() ? NULL : &chunk->m_Data.m_Tilesets.front();
+  if(ts != NULL)
+  {
+    auto imgName = map->getTilesetImgName(ts->id);
+    auto iter = imgName ? tilesetImgs->find(*imgName) : tilesetImgs->end();
+    if(iter != tilesetImgs->end())
+    {
+      tilesetImg = &iter->second;
+    }
+  }
+
+  for(unsigned y = 0; y < chunkSize; y++)
+  {
+    for(unsigned x = 0; x < chunkSize; x++)
+    {
+      uint8_t* texel = first + (y * size + x) * 4;
+
+      if(tilesetImg != NULL)
+      {
+        const uint8_t* color = tilesetImg->cellColor(static_cast<unsigned char>(ts->tileData.get(x, y).index));
+        if(color != NULL && ts->tileData.get(x, y).index != 0)
+        {
+          std::copy(color, color + 4, texel);
+        }
+      }
+
+      //blocked cells darker, so paths stand out
+      if(chunk->m_Data.m_GameLayer.get(x, y) != 0)
+      {
+        if(texel[3] == 0)
+        {
+          texel[0] = texel[1] = texel[2] = 120;
+        }
+        texel[0] /= 2;
+        texel[1] /= 2;
+        texel[2] /= 2;
+        texel[3] = 255;
+      }
+    }
+  }
+}
+
+void Minimap::update(vec2<float> worldCenter)
+{
+  if(image == NULL)
+  {
+    return;
+  }
+
+  //moving on by a chunk shifts every slot, redrawing them is cheaper than keeping track
+  vec2<int> newCenter = game::math::entityToChunkPos(worldCenter);
+  if(newCenter != center)
+  {
+    center = newCenter;
+    std::fill(slotRevisions.begin(), slotRevisions.end(), 0);
+  }
+
+  int slots = 2*radius + 1;
+  int firstX = slots, firstY = slots, lastX = -1, lastY = -1;
+
+  for(int slotY = 0; slotY < slots; slotY++)
+  {
+    for(int slotX = 0; slotX < slots; slotX++)
+    {
+      auto chunk = map->getIdealChunk(vec2<int>(center[0] + slotX - radius, center[1] + slotY - radius));
+
+      //unloaded chunks get a revision no chunk has
+      uint64_t revision = chunk ? chunk->get()->getRevision() : UINT64_MAX;
+      uint64_t& slotRevision = slotRevisions[slotY * slots + slotX];
+      if(revision == slotRevision)
+      {
+        continue;
+      }
+
+      drawChunk(chunk ? chunk->get() : nullptr, slotX, slotY);
+      slotRevision = revision;
+
+      firstX = std::min(firstX, slotX);
+      firstY = std::min(firstY, slotY);
+      lastX = std::max(lastX, slotX);
+      lastY = std::max(lastY, slotY);
+    }
+  }
+
+  if(lastX < 0)
+  {
+    return;
+  }
+
+  //one upload for everything that changed, the rows of the rect are size texels apart in pixels
+  constexpr int chunkSize = game::math::chunkSize;
+  GPU_Rect dirty = GPU_MakeRect(firstX * chunkSize, firstY * chunkSize, (lastX - firstX + 1) * chunkSize, (lastY - firstY + 1) * chunkSize);
+  GPU_UpdateImageBytes(image, &dirty, &pixels[(static_cast<size_t>(firstY) * chunkSize * size + firstX * chunkSize) * 4], size * 4);
+}
@@ -0,0 +1,246 @@
+/*
+ *  FILENAME:      mipchain.cpp
+ *
+ *  DESCRIPTION:
+ *      CPU side generation of LOD levels (2x2 box filter) and a disk cache for generated chains
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <filesystem>
+
+#ifdef __SSE2__
+  #include <emmintrin.h>
+#endif
+
+#include "renderer/mipchain.h"
+
+namespace
+{
+  constexpr uint32_t cacheMagic   = 0x444f4c42; // "BLOD"
+  constexpr uint32_t cacheVersion = 1;
+
+  struct SourceStamp
+  {
+    uint64_t size;
+    int64_t  time;
+  };
+
+  bool sourceStamp(const std::string& sourcePath, SourceStamp& stamp)
+  {
+    std::error_code ec;
+    stamp.size = std::filesystem::file_size(sourcePath, ec);
+    if (ec)
+    {
+      return false;
+    }
+    stamp.time = std::filesystem::last_write_time(sourcePath, ec).time_since_epoch().count();
+    return !ec;
+  }
+
+  template<typename T>
+  void writeRaw(std::ofstream& out, T value)
+  {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+
+  template<typename T>
+  bool readRaw(std::ifstream& in, T& value)
+  {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+  }
+
+  // averages 2x2 blocks of row0/row1 into dst, four source pixels per iteration
+  unsigned downsampleRowSSE(const uint8_t* row0, const uint8_t* row1, uint8_t* dst, unsigned dstWidth)
+  {
+    unsigned x = 0;
+#ifdef __SSE2__
+    const __m128i zero  = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi16(2);
+
+    for (; x + 2 <= dstWidth; x += 2)
+    {
+      __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 8));
+      __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 8));
+
+      // vertical sums of pixels 0,1 (lo) and 2,3 (hi) as 16 bit channels
+      __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+      __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+
+      // horizontal sums: [p0+p1, p2+p3]
+      __m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi));
+      sum = _mm_srli_epi16(_mm_add_epi16(sum, round), 2);
+
+      _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + x * 4), _mm_packus_epi16(sum, zero));
+    }
+#endif
+    return x;
+  }
+}
+
+namespace mipchain
+{
+  Level downsample(const Level& src)
+  {
+    Level dst;
+    dst.w = src.w / 2;
+    dst.h = src.h / 2;
+    dst.pixels.resize(static_cast<size_t>(dst.w) * dst.h * 4);
+
+    const size_t srcPitch = static_cast<size_t>(src.w) * 4;
+
+    for (unsigned y = 0; y < dst.h; y++)
+    {
+      const uint8_t* row0 = &src.pixels[(2 * y)     * srcPitch];
+      const uint8_t* row1 = &src.pixels[(2 * y + 1) * srcPitch];
+      uint8_t* out = &dst.pixels[static_cast<size_t>(y) * dst.w * 4];
+
+      for (unsigned x = downsampleRowSSE(row0, row1, out, dst.w); x < dst.w; x++)
+      {
+        for (unsigned c = 0; c < 4; c++)
+        {
+          unsigned sum = row0[x * 8 + c] + row0[x * 8 + 4 + c] + row1[x * 8 + c] + row1[x * 8 + 4 + c];
+          out[x * 4 + c] = static_cast<uint8_t>((sum + 2) / 4);
+        }
+      }
+    }
+
+    return dst;
+  }
+
+  void extend(Chain& chain, unsigned minWidth)
+  {
+    if (chain.empty())
+    {
+      return;
+    }
+
+    chain.reserve(chain.size() + static_cast<size_t>(std::log2(std::max(1u, chain.back().w))) + 1);
+
+    while (chain.back().w / 2 >= minWidth && chain.back().w / 2 > 0 && chain.back().h / 2 > 0)
+    {
+      chain.push_back(downsample(chain.back()));
+    }
+  }
+
+  size_t levelForWidth(unsigned baseWidth, size_t levelCount, float optimalWidth)
+  {
+    if (levelCount == 0 || optimalWidth >= baseWidth)
+    {
+      return 0;
+    }
+    if (optimalWidth <= 0.f)
+    {
+      return levelCount - 1;
+    }
+
+    // width of level i is baseWidth >> i, so the wanted level is floor(log2(baseWidth / optimalWidth))
+    auto index = std::min(static_cast<size_t>(std::log2(baseWidth / optimalWidth)), levelCount - 1);
+
+    // guard against rounding at exact powers of two
+    if (index > 0 && (baseWidth >> index) < optimalWidth)
+    {
+      index--;
+    }
+    else if (index + 1 < levelCount && (baseWidth >> (index + 1)) >= optimalWidth)
+    {
+      index++;
+    }
+
+    return index;
+  }
+
+  std::string cachePath(const std::string& cacheDir, const std::string& sourcePath)
+  {
+    std::string name = sourcePath;
+    for (auto& c : name)
+    {
+      if (c == '/' || c == '\\' || c == ':')
+      {
+        c = '_';
+      }
+    }
+    return cacheDir + name + ".lod";
+  }
+
+  bool loadCache(const std::string& cacheFile, const std::string& sourcePath, unsigned minWidth, Chain& chain)
+  {
+    SourceStamp stamp;
+    if (!sourceStamp(sourcePath, stamp))
+    {
+      return false;
+    }
+
+    std::ifstream in(cacheFile, std::ios::in | std::ios::binary);
+    if (!in.is_open())
+    {
+      return false;
+    }
+
+    uint32_t magic, version, cachedMinWidth, levelCount;
+    SourceStamp cachedStamp;
+
+    if (!readRaw(in, magic) || !readRaw(in, version) || !readRaw(in, cachedStamp.size) || !readRaw(in, cachedStamp.time) ||
+        !readRaw(in, cachedMinWidth) || !readRaw(in, levelCount))
+    {
+      return false;
+    }
+
+    if (magic != cacheMagic || version != cacheVersion || cachedMinWidth != minWidth ||
+        cachedStamp.size != stamp.size || cachedStamp.time != stamp.time || levelCount == 0 || levelCount > 32)
+    {
+      return false;
+    }
+
+    Chain result(levelCount);
+    for (auto& level : result)
+    {
+      if (!readRaw(in, level.w) || !readRaw(in, level.h) || level.w > 16384 || level.h > 16384)
+      {
+        return false;
+      }
+      level.pixels.resize(static_cast<size_t>(level.w) * level.h * 4);
+      if (!in.read(reinterpret_cast<char*>(level.pixels.data()), level.pixels.size()))
+      {
+        return false;
+      }
+    }
+
+    chain = std::move(result);
+    return true;
+  }
+
+  void saveCache(const std::string& cacheFile, const std::string& sourcePath, unsigned minWidth, const Chain& chain)
+  {
+    SourceStamp stamp;
+    if (chain.empty() || !sourceStamp(sourcePath, stamp))
+    {
+      return;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(cacheFile).parent_path(), ec);
+
+    std::ofstream out(cacheFile, std::ios::out | std::ios::binary);
+    if (!out.is_open())
+    {
+      return;
+    }
+
+    writeRaw(out, cacheMagic);
+    writeRaw(out, cacheVersion);
+    writeRaw(out, stamp.size);
+    writeRaw(out, stamp.time);
+    writeRaw(out, static_cast<uint32_t>(minWidth));
+    writeRaw(out, static_cast<uint32_t>(chain.size()));
+
+    for (const auto& level : chain)
+    {
+      writeRaw(out, level.w);
+      writeRaw(out, level.h);
+      out.write(reinterpret_cast<const char*>(level.pixels.data()), level.pixels.size());
+    }
+  }
+}
@@ -13,11 +13,14 @@
  *
  */
 
+#include <cassert>
 #include <iostream>
 #include <utility>
 #include <cmath>
 #include <string>
 #include <fstream>
+#include <climits>
+#include <algorithm>
 
 #include "rapidjson/document.h"
 #include "rapidjson/istreamwrapper.h"
@@ -25,10 +28,35 @@
 #include "renderer/renderer.h"
 #include "game/entity.h"
 #include "game/gamemath.hpp"
+#include "game/profiler.h"
+
+namespace
+{
+  //frees the textures that weren't drawn for keepTicks
+  template<typename Key, typename Entry>
+  void releaseUnused(std::map<Key, Entry>& textures, uint32_t keepTicks)
+  {
+    for(auto it = textures.begin(); it != textures.end();)
+    {
+      if(global::tickCount - it->second.lastUsed > keepTicks)
+      {
+        GPU_FreeImage(it->second.image);
+        it = textures.erase(it);
+      }
+      else
+      {
+        ++it;
+      }
+    }
+  }
+}
 
 Renderer::Renderer(float w, float h, bool fullscreen, Map* map)
 {
   renderTarget = NULL;
+  globalTs = NULL;
+  tilemapMode = true;
+  overviewLoads = 0;
   //Add error handling!
   SDL_Init(SDL_INIT_VIDEO);
   win = SDL_CreateWindow("Hier kann Ihr Titel stehen" , SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, w, h, SDL_WINDOW_SHOWN|SDL_WINDOW_ALLOW_HIGHDPI|SDL_WINDOW_OPENGL|SDL_WINDOW_RESIZABLE);
@@ -104,6 +132,7 @@ Renderer::Renderer(float w, float h, bool fullscreen, Map* map)
   GPU_SetUniformfv(GPU_GetUniformLocation(sp_tile, "lights"), 3, 3, lights);
   GPU_SetUniformfv(GPU_GetUniformLocation(sp_tile, "lightColors"), 3, 3, lightColors);
   GPU_SetUniformi(GPU_GetUniformLocation(sp_tile, "numLights"), 3);
+  GPU_SetUniformi(GPU_GetUniformLocation(sp_tile, "tilemapMode"), 0);
 
   GPU_DeactivateShaderProgram();
 
@@ -130,13 +159,13 @@ Renderer::Renderer(float w, float h, bool fullscreen, Map* map)
       paths_n.push_back(tilesetDirectory + std::string(image.GetString()));
     }
 
-    LODImage newlod(&paths[0], paths.size(), entry["min_resolution"].GetInt());
+    LODImage newlod(&paths[0], paths.size(), entry["min_resolution"].GetInt(), lodCacheDirectory);
     tilesetImgs.insert(std::make_pair(
         std::string(entry["tileset"].GetString()),
         newlod
     ));
 
-    LODImage newlod_n(&paths_n[0], paths_n.size(), entry["min_resolution"].GetInt());
+    LODImage newlod_n(&paths_n[0], paths_n.size(), entry["min_resolution"].GetInt(), lodCacheDirectory);
     tilesetNormals.insert(std::make_pair(
         std::string(entry["tileset"].GetString()),
         newlod_n
@@ -146,6 +175,14 @@ Renderer::Renderer(float w, float h, bool fullscreen, Map* map)
 
 Renderer::~Renderer()
 {
+  for(auto& entry: tilemaps)
+  {
+    GPU_FreeImage(entry.second.image);
+  }
+  for(auto& entry: overviews)
+  {
+    GPU_FreeImage(entry.second.image);
+  }
   GPU_FreeTarget(renderTarget);
 }
 
@@ -159,7 +196,7 @@ size_t Renderer::addCamera(float x, float y, float w, float h, float scale)
 {
 
   size_t theId = getCameraId();
-  cameras.push_back(CameraEntry{
+  cameras.push_back(CameraEntry(
     std::make_shared<Camera>(
       0,
       0,
@@ -171,14 +208,15 @@ size_t Renderer::addCamera(float x, float y, float w, float h, float scale)
     std::array<float,4>{x, y, w, h},
 
     theId
-  });
+  ));
 
+  setScale(theId, scale);
   map->addEntity(getCamera(theId).camera);
 
   return theId;
 }
 
-CameraEntry Renderer::getCamera(size_t id)
+CameraEntry& Renderer::getCamera(size_t id)
 {
   for(auto camIt = cameras.begin(); camIt != cameras.end(); ++camIt)
   {
@@ -188,7 +226,10 @@ CameraEntry Renderer::getCamera(size_t id)
     }
   }
   
-  return CameraEntry{nullptr, std::array<float, 4> { 0.f }, 0};
+  //no such camera, handed out fresh every time so nothing written to it sticks
+  static CameraEntry none(nullptr, std::array<float, 4> { 0.f }, 0);
+  none = CameraEntry(nullptr, std::array<float, 4> { 0.f }, 0);
+  return none;
 }
 
 float Renderer::getWidth() const
@@ -259,9 +300,15 @@ void Renderer::resizeCameras() {
 void Renderer::renderFrame()
 {
   GPU_ClearRGB(renderTarget, 50, 50, 50);
+  overviewLoads = 0;
   
   GPU_ActivateShaderProgram(sp_tile, &block_tile);
   GPU_SetUniformf(GPU_GetUniformLocation(sp_tile, "time"), SDL_GetTicks()/1000.f);
+  GPU_SetUniformi(GPU_GetUniformLocation(sp_tile, "tilemapMode"), tilemapMode ? 1 : 0);
+
+  //once per frame for all cameras
+  prepareFrame();
+
   //tiles & entities
   for(CameraEntry& camera: cameras)
   {
@@ -271,6 +318,10 @@ void Renderer::renderFrame()
     renderCamera(camera);
   }
 
+  //entities are regular blits, tilemap lookup has to be off
+  GPU_FlushBlitBuffer();
+  GPU_SetUniformi(GPU_GetUniformLocation(sp_tile, "tilemapMode"), 0);
+
   for(CameraEntry& camera: cameras)
   {
     renderCameraEntities(camera);
@@ -278,6 +329,11 @@ void Renderer::renderFrame()
   GPU_DeactivateShaderProgram();
 
   //overlays
+  for(auto& minimap: minimaps)
+  {
+    minimap.second->update(getCamera(minimap.first).camera->getPos());
+  }
+
   for(CameraEntry& camera: cameras)
   {
     std::shared_ptr camcast = std::static_pointer_cast<Camera>(camera.camera);
@@ -315,6 +371,16 @@ void Renderer::renderFrame()
   //draw miscellaneous items
   drawBoxes();
 
+  releaseTilemaps();
+  releaseOverviews();
+
+#ifdef DEBUG_RENDERER_VERBOSE
+  static Camera::Stats lastStats;
+  std::cout << "[RENDERER] blits: " << Camera::stats.blits - lastStats.blits
+            << " tiles visited: " << Camera::stats.tilesVisited - lastStats.tilesVisited
+            << " empty tilesets skipped: " << Camera::stats.tilesetsSkipped - lastStats.tilesetsSkipped << std::endl;
+  lastStats = Camera::stats;
+#endif
 }
 
 void Renderer::drawBoxes() {
@@ -330,12 +396,13 @@ void Renderer::drawBoxes() {
   boxQueue.clear();
 }
 
-bool Renderer::chunkInBounds(const Chunk& chunk, const CameraEntry& camera)
+bool Renderer::chunkInBounds(vec2<int> chunkPos, const CameraEntry& camera)
 {
   Camera* camptr = std::static_pointer_cast<Camera>(camera.camera).get();
   
-  auto chunkUpperLeft  = game::math::chunkToEntityPos(chunk.getPos()) - vec2<float>{ .5f, .5f };
-  auto chunkLowerRight = game::math::chunkToEntityPos(chunk.getPos()) + ((game::math::chunkSize + .5f) * vec2<float>{ 1.f, 1.f });
+  //half a tile of slack for tileset offsets
+  auto chunkUpperLeft  = game::math::chunkToEntityPos(chunkPos) - vec2<float>{ .5f, .5f };
+  auto chunkLowerRight = game::math::chunkToEntityPos(chunkPos) + ((game::math::chunkSize + .5f) * vec2<float>{ 1.f, 1.f });
   
   vec2<> camUpperLeft(camptr->getPos() - 0.5f*camptr->unitsInPixel()*camptr->getSize());
   vec2<> camLowerRight(camptr->getPos() + 0.5f*camptr->unitsInPixel()*camptr->getSize());
@@ -343,7 +410,152 @@ bool Renderer::chunkInBounds(const Chunk& chunk, const CameraEntry& camera)
   return (chunkUpperLeft[0] <= camLowerRight[0] &&
           chunkUpperLeft[1] <= camLowerRight[1] &&
           chunkLowerRight[0] >= camUpperLeft[0] &&
-          chunkLowerRight[0] >= camUpperLeft[0]);
+          chunkLowerRight[1] >= camUpperLeft[1]);
+}
+
+bool Renderer::updateVisibleChunks(CameraEntry& camera)
+{
+  Camera* camptr = std::static_pointer_cast<Camera>(camera.camera).get();
+
+  vec2<float> halfView = 0.5f*camptr->unitsInPixel()*camptr->getSize();
+  vec2<int> first = game::math::entityToChunkPos(camptr->getPos() - halfView - vec2<float>{ .5f, .5f });
+  vec2<int> last  = game::math::entityToChunkPos(camptr->getPos() + halfView + vec2<float>{ .5f, .5f });
+
+  //same chunks as last frame, the view hasn't crossed a chunk border or zoomed past one
+  if(first == camera.visibleFirst && last == camera.visibleLast)
+  {
+    return false;
+  }
+  camera.visibleFirst = first;
+  camera.visibleLast = last;
+
+  camera.visibleChunks.clear();
+  for(int y = first[1]; y <= last[1]; y++)
+  {
+    for(int x = first[0]; x <= last[0]; x++)
+    {
+      if(chunkInBounds(vec2<int>(x, y), camera))
+      {
+        camera.visibleChunks.push_back(vec2<int>(x, y));
+      }
+    }
+  }
+  return true;
+}
+
+bool Renderer::chunkVisible(vec2<int> chunkPos, const CameraEntry& camera) const
+{
+  //visibleChunks is everything between first and last, see updateVisibleChunks
+  return chunkPos[0] >= camera.visibleFirst[0] && chunkPos[0] <= camera.visibleLast[0] &&
+         chunkPos[1] >= camera.visibleFirst[1] && chunkPos[1] <= camera.visibleLast[1];
+}
+
+void Renderer::prepareFrame()
+{
+  PROFILE_ZONE("Renderer::prepareFrame");
+
+  bool changed = false;
+  bool anyTiles = false;
+  for(CameraEntry& camera: cameras)
+  {
+    changed |= updateVisibleChunks(camera);
+    anyTiles |= !useOverview(std::static_pointer_cast<Camera>(camera.camera).get());
+  }
+
+  //split screen cameras usually look at the same chunks
+  if(changed)
+  {
+    visibleUnion.clear();
+    for(const CameraEntry& camera: cameras)
+    {
+      visibleUnion.insert(visibleUnion.end(), camera.visibleChunks.begin(), camera.visibleChunks.end());
+    }
+    auto byRow = [](const vec2<int>& a, const vec2<int>& b) { return a[1] != b[1] ? a[1] < b[1] : a[0] < b[0]; };
+    std::sort(visibleUnion.begin(), visibleUnion.end(), byRow);
+    visibleUnion.erase(std::unique(visibleUnion.begin(), visibleUnion.end()), visibleUnion.end());
+  }
+
+  preparedLayers.clear();
+  preparedEntities.clear();
+  resolvedImages.clear();
+
+  for(const auto& chunkPos: visibleUnion)
+  {
+    auto chunk = map->getIdealChunk(chunkPos);
+    if(!chunk)
+    {
+      continue;
+    }
+
+    //cameras showing the overview don't draw chunk tiles
+    if(anyTiles)
+    {
+      for(const auto& ts: chunk->get()->m_Data.m_Tilesets)
+      {
+        vec2<float> chunkOffset = game::math::chunkToEntityPos(chunkPos) + vec2<float>(ts.offsetX,ts.offsetY);
+        prepareLayer(ts, TilemapKey{chunkPos[0], chunkPos[1], ts.id}, false, chunkOffset[0], chunkOffset[1]);
+        preparedLayers.back().chunkPos = chunkPos;
+      }
+    }
+
+    game::for_each_variant_by_type<Entity>(chunk->get()->m_Data.m_Entities,
+      [&](auto& entity) -> void
+      {
+        //sliced, drawing only needs position, size, anchor and sprite
+        preparedEntities.push_back(entity);
+      }
+    );
+  }
+
+  if(globalTs != NULL)
+  {
+    prepareLayer(*globalTs, TilemapKey{INT_MIN, INT_MIN, globalTs->id}, true, globalTs->offsetX, globalTs->offsetY);
+  }
+}
+
+void Renderer::prepareLayer(const Tileset& ts, const TilemapKey& key, bool global, float x_offset, float y_offset)
+{
+  //e.g. a layer the editor emptied, no textures to bind or tilemap to encode
+  if(ts.tileData.empty())
+  {
+    Camera::stats.tilesetsSkipped++;
+    return;
+  }
+
+  auto resolved = resolvedImages.find(ts.id);
+  if(resolved == resolvedImages.end())
+  {
+    std::pair<LODImage*, LODImage*> images {NULL, NULL};
+    auto imgName = map->getTilesetImgName(ts.id);
+    if(imgName)
+    {
+      auto iter = tilesetImgs.find(*imgName);
+      auto iter_n = tilesetNormals.find(*imgName);
+      if(iter != tilesetImgs.end() && iter_n != tilesetNormals.end())
+      {
+        images = {&iter->second, &iter_n->second};
+      }
+    }
+    resolved = resolvedImages.emplace(ts.id, images).first;
+  }
+
+  if(resolved->second.first == NULL)
+  {
+    return;
+  }
+
+  //the index texture is shared by all cameras, encoded and uploaded once
+  GPU_Image* indexMap = NULL;
+  if(tilemapMode)
+  {
+    indexMap = getTilemapImage(key, ts);
+    if(indexMap == NULL)
+    {
+      return;
+    }
+  }
+
+  preparedLayers.push_back(PreparedLayer{ts, vec2<int>(0, 0), global, resolved->second.first, resolved->second.second, indexMap, x_offset, y_offset});
 }
 
 GPU_Image* Renderer::LoadImageWithMipmaps(const char* filename)
@@ -369,6 +581,7 @@ LODImage testLoadLOD()
 
 void Renderer::renderCamera(CameraEntry& camera)
 {
+  PROFILE_ZONE("Renderer::renderCamera");
 
   //static LODImage testImg = testLoadLOD();
   Map::SharedEntityPtr theCam = camera.camera;
@@ -376,69 +589,247 @@ void Renderer::renderCamera(CameraEntry& camera)
 
   camcast.get()->clearRender();
 
-  auto topLeftScreen =     pixelToXYAuto(vec2<float>(1.f, 1.f));
-  auto bottomRightScreen = pixelToXYAuto(camcast.get()->getSize() - vec2<float>(1.f, 1.f));
-  
-  map->for_each_chunk_in_box(topLeftScreen, bottomRightScreen - topLeftScreen, 
-    [&](auto&& chunk) -> void
+  bool overview = useOverview(camcast.get());
+  if(overview)
+  {
+    renderOverview(camcast.get());
+  }
+
+  for(const PreparedLayer& layer: preparedLayers)
+  {
+    if(layer.global || (!overview && chunkVisible(layer.chunkPos, camera)))
+    {
+      renderTilesetLayer(camcast.get(), layer);
+    }
+  }
+
+  return;
+}
+
+void Renderer::renderTilesetLayer(Camera* cam, const PreparedLayer& layer)
+{
+  GPU_SetShaderImage(layer.normals->bestImage(cam), GPU_GetUniformLocation(sp_tile, "nmap"), 1);
+
+  if(tilemapMode)
+  {
+    //single draw for the whole layer, tiles are resolved by the tile shader
+    float size[] = {static_cast<float>(layer.indexMap->w), static_cast<float>(layer.indexMap->h)};
+    GPU_SetShaderImage(layer.image->bestImage(cam), GPU_GetUniformLocation(sp_tile, "atlas"), 2);
+    GPU_SetUniformfv(GPU_GetUniformLocation(sp_tile, "tilemapSize"), 2, 1, size);
+
+    cam->renderTilemap(layer.tileset, layer.indexMap, layer.x_offset, layer.y_offset);
+  }
+  else
+  {
+    cam->renderTileset(layer.tileset, layer.image->bestImage(cam), 0.f, 0.f, layer.x_offset, layer.y_offset);
+  }
+}
+
+GPU_Image* Renderer::getTilemapImage(const TilemapKey& key, const Tileset& ts)
+{
+  tilemap::encode(ts, tilemapScratch);
+  if(tilemapScratch.w == 0 || tilemapScratch.h == 0)
+  {
+    return NULL;
+  }
+
+  auto hash = tilemapScratch.hash();
+  auto& entry = tilemaps[key];
+  bool upload = false;
+
+  //tileset changed its dimensions, recreate
+  if(entry.image != NULL && (entry.image->w != tilemapScratch.w || entry.image->h != tilemapScratch.h))
+  {
+    GPU_FreeImage(entry.image);
+    entry.image = NULL;
+  }
+
+  if(entry.image == NULL)
+  {
+    entry.image = GPU_CreateImage(tilemapScratch.w, tilemapScratch.h, GPU_FORMAT_RGBA);
+    if(entry.image == NULL)
+    {
+      tilemaps.erase(key);
+      return NULL;
+    }
+    GPU_SetImageFilter(entry.image, GPU_FILTER_NEAREST);
+    upload = true;
+  }
+
+  //only touch the texture if tiles changed since the last frame it was used
+  if(upload || entry.hash != hash)
+  {
+    GPU_UpdateImageBytes(entry.image, NULL, tilemapScratch.texels.data(), tilemapScratch.w * 4);
+    entry.hash = hash;
+  }
+
+  entry.lastUsed = global::tickCount;
+  return entry.image;
+}
+
+void Renderer::releaseTilemaps()
+{
+  releaseUnused(tilemaps, tilemapKeepTicks);
+}
+
+bool Renderer::useOverview(const Camera* cam) const
+{
+  return cam->pixelsInUnit() * game::math::tileWidth < overviewTilePixels;
+}
+
+float Renderer::clampScale(const Camera* cam, float scale) const
+{
+  //scale is the height of the view in units, wide cameras are limited by their width
+  float maxUnits = overviewMaxRegions * Overview::regionTiles * game::math::tileWidth;
+  float aspect = cam->getSize()[0] / cam->getSize()[1];
+  return std::min(scale, maxUnits / std::max(aspect, 1.f));
+}
+
+void Renderer::renderOverview(Camera* cam)
+{
+  PROFILE_ZONE("Renderer::renderOverview");
+
+  //coarsest level that still has texels of at least a pixel
+  unsigned level = 1;
+  float texelPixels = cam->pixelsInUnit() * game::math::tileWidth;
+  while(level < Overview::levelCount && texelPixels < 1.f)
+  {
+    texelPixels *= Overview::levelFactor;
+    level++;
+  }
+
+  float regionUnits = Overview::regionTiles * game::math::tileWidth;
+  vec2<float> halfView = cam->getSize() * (.5f * cam->unitsInPixel());
+  vec2<float> topLeft = cam->getPos() - halfView;
+  vec2<float> bottomRight = cam->getPos() + halfView;
+
+  //plain blits, the tile shader would read them as tilemaps
+  GPU_FlushBlitBuffer();
+  GPU_DeactivateShaderProgram();
+
+  for(int y = floor(topLeft[1] / regionUnits); y <= floor(bottomRight[1] / regionUnits); y++)
+  {
+    for(int x = floor(topLeft[0] / regionUnits); x <= floor(bottomRight[0] / regionUnits); x++)
     {
-      for(const auto& ts: chunk.m_Data.m_Tilesets)
+      GPU_Image* img = getOverviewImage(OverviewKey{x, y, level});
+      if(img != NULL)
       {
-        //render all tilesets of current chunk
-
-        vec2<float> chunkOffset = game::math::chunkToEntityPos(chunk.getPos()) + vec2<float>(ts.offsetX,ts.offsetY);
-
-        auto imgName = map->getTilesetImgName(ts.id);
-        
-        if (imgName)
-        {
-          auto iter = tilesetImgs.find(*imgName);
-          auto iter_n = tilesetNormals.find(*imgName);
-          auto& tilesetImg = std::get<LODImage>(*(iter));
-          auto& tilesetImg_n = std::get<LODImage>(*(iter_n));
-
-          GPU_SetShaderImage(tilesetImg_n.bestImage(camcast.get()), GPU_GetUniformLocation(sp_tile, "nmap"), 1);
-          camcast.get()->renderTileset(ts, tilesetImg.bestImage(camcast.get()), 0.f, 0.f, chunkOffset[0], chunkOffset[1]);
-        }
+        cam->renderImage(img, x * regionUnits, y * regionUnits, regionUnits, regionUnits);
       }
     }
-  );
-  
-  if(globalTs != NULL) {
-    auto imgName = map->getTilesetImgName(globalTs->id);
-        
-    if (imgName)
+  }
+
+  GPU_FlushBlitBuffer();
+  GPU_ActivateShaderProgram(sp_tile, &block_tile);
+}
+
+GPU_Image* Renderer::getOverviewImage(const OverviewKey& key)
+{
+  Overview& overview = map->getOverview();
+  vec2<int> region(std::get<0>(key), std::get<1>(key));
+  auto found = overviews.find(key);
+
+  if(found != overviews.end() && found->second.revision == overview.getRevision(region))
+  {
+    found->second.lastUsed = global::tickCount;
+    return found->second.image;
+  }
+
+  //regions not in memory come from disk, spread that over several frames and show the old texture meanwhile
+  if(!overview.isCached(region))
+  {
+    if(overviewLoads >= overviewLoadsPerFrame)
     {
-      auto iter = tilesetImgs.find(*imgName);
-      auto iter_n = tilesetNormals.find(*imgName);
-      auto& tilesetImg = std::get<LODImage>(*(iter));
-      auto& tilesetImg_n = std::get<LODImage>(*(iter_n));
-      GPU_SetShaderImage(tilesetImg_n.bestImage(camcast.get()), GPU_GetUniformLocation(sp_tile, "nmap"), 1);
-      camcast.get()->renderTileset(*globalTs, tilesetImg.bestImage(camcast.get()), 0.f, 0.f, globalTs->offsetX, globalTs->offsetY);
+      return found != overviews.end() ? found->second.image : NULL;
     }
+    overviewLoads++;
   }
 
-  return;
+  uint32_t revision;
+  if(!overview.getLevel(region, std::get<2>(key), overviewScratch, revision))
+  {
+    return NULL;
+  }
+
+  //tiles to colours, tileset names are resolved once per tileset
+  std::map<unsigned, const LODImage*> images;
+  overviewPixels.assign(overviewScratch.size() * 4, 0);
+  for(size_t i = 0; i < overviewScratch.size(); i++)
+  {
+    Overview::Texel texel = overviewScratch[i];
+    if(texel == 0)
+    {
+      continue;
+    }
+
+    unsigned id = Overview::tilesetId(texel);
+    auto image = images.find(id);
+    if(image == images.end())
+    {
+      auto imgName = map->getTilesetImgName(id);
+      auto iter = imgName ? tilesetImgs.find(*imgName) : tilesetImgs.end();
+      image = images.emplace(id, iter != tilesetImgs.end() ? &iter->second : NULL).first;
+    }
+
+    const uint8_t* color = image->second != NULL ? image->second->cellColor(Overview::tileIndex(texel)) : NULL;
+    if(color != NULL)
+    {
+      std::copy(color, color + 4, &overviewPixels[i * 4]);
+    }
+  }
+
+  unsigned size = Overview::levelSize(std::get<2>(key));
+  auto& entry = overviews[key];
+  if(entry.image == NULL)
+  {
+    entry.image = GPU_CreateImage(size, size, GPU_FORMAT_RGBA);
+    if(entry.image == NULL)
+    {
+      overviews.erase(key);
+      return NULL;
+    }
+    GPU_SetImageFilter(entry.image, GPU_FILTER_NEAREST);
+  }
+
+  GPU_UpdateImageBytes(entry.image, NULL, overviewPixels.data(), size * 4);
+  entry.revision = revision;
+  entry.lastUsed = global::tickCount;
+  return entry.image;
+}
+
+void Renderer::releaseOverviews()
+{
+  releaseUnused(overviews, tilemapKeepTicks);
 }
 
 void Renderer::renderCameraEntities(CameraEntry& camera)
 {
+  PROFILE_ZONE("Renderer::renderCameraEntities");
+
   Map::SharedEntityPtr theCam = camera.camera;
   std::shared_ptr camcast = std::static_pointer_cast<Camera>(theCam);
 
-  auto topLeftScreen =     pixelToXYAuto(vec2<float>(1.f, 1.f));
-  auto bottomRightScreen = pixelToXYAuto(camcast.get()->getSize() - vec2<float>(1.f, 1.f));
-  
-  map->for_each_entity_in_box<Entity>(topLeftScreen, bottomRightScreen - topLeftScreen, 
-    [&](auto& entity) -> void
+  vec2<float> halfView = 0.5f*camcast.get()->unitsInPixel()*camcast.get()->getSize();
+  vec2<float> viewUpperLeft = camcast.get()->getPos() - halfView;
+  vec2<float> viewLowerRight = camcast.get()->getPos() + halfView;
+
+  for(Entity& entity: preparedEntities)
+  {
+    //drawn from pos - anchor*size, partly visible ones count
+    vec2<float> upperLeft = entity.getPos() - vec2<float>(entity.getAnchor()[0]*entity.getSize()[0], entity.getAnchor()[1]*entity.getSize()[1]);
+    vec2<float> lowerRight = upperLeft + entity.getSize();
+
+    if(upperLeft[0] <= viewLowerRight[0] && upperLeft[1] <= viewLowerRight[1] &&
+       lowerRight[0] >= viewUpperLeft[0] && lowerRight[1] >= viewUpperLeft[1])
     {
       camcast.get()->renderEntity(entity);
     }
-  );
+  }
 }
 
 void Renderer::show()
 {
+  PROFILE_ZONE("GPU_Flip");
   GPU_Flip(renderTarget);
 }
 
@@ -462,18 +853,18 @@ void Renderer::setCameraPos(size_t cameraId, vec2<float> pos)
 void Renderer::zoomCamera(size_t cameraId, float factor)
 {
   Camera* cam = std::static_pointer_cast<Camera>(getCamera(cameraId).camera).get();
-  cam->setScale(cam->getScale()*factor);
+  cam->setScale(clampScale(cam, cam->getScale()*factor));
 }
 
 void Renderer::setScale(size_t cameraId, float scale) 
 {
   Camera* cam = std::static_pointer_cast<Camera>(getCamera(cameraId).camera).get();
-  cam->setScale(scale);
+  cam->setScale(clampScale(cam, scale));
 }
 
 void Renderer::tick(float tickTime)
 {
-  for(CameraEntry entry: cameras)
+  for(CameraEntry& entry: cameras)
   {
     std::static_pointer_cast<Camera>(entry.camera).get()->tick();
   }
@@ -481,6 +872,16 @@ void Renderer::tick(float tickTime)
   renderFrame();
 }
 
+std::vector<vec2<float>> Renderer::getCameraPositions() const
+{
+  std::vector<vec2<float>> positions;
+  for(const CameraEntry& entry: cameras)
+  {
+    positions.push_back(entry.camera->getPos());
+  }
+  return positions;
+}
+
 float Renderer::getCameraScale(size_t cameraIndex)
 {
   float ret = std::static_pointer_cast<Camera>(getCamera(cameraIndex).camera).get()->getScale();
@@ -507,6 +908,27 @@ void Renderer::setGlobalTileset(Tileset* ts)
   globalTs = ts;
 }
 
+void Renderer::setTilemapMode(bool enabled)
+{
+  tilemapMode = enabled;
+}
+
+void Renderer::setMinimap(size_t cameraId, bool enabled)
+{
+  auto found = minimaps.find(cameraId);
+  if(enabled && found == minimaps.end())
+  {
+    auto& minimap = minimaps[cameraId];
+    minimap = std::make_unique<Minimap>(map, &tilesetImgs);
+    addOverlay(cameraId, minimap->getOverlay());
+  }
+  else if(!enabled && found != minimaps.end())
+  {
+    removeOverlay(cameraId, found->second->getOverlay());
+    minimaps.erase(found);
+  }
+}
+
 void Renderer::renderBox(float x, float y, float w, float h, SDL_Color borderColor, SDL_Color areaColor, float borderRadius)
 {
   boxQueue.push_back({x, y, w, h, borderColor, areaColor, borderRadius});
@@ -523,10 +945,11 @@ vec2<float> Renderer::pixelToXYAuto(vec2<float> pixel)
 
   for(auto camIt = cameras.begin(); camIt != cameras.end(); ++camIt)
   {
-    if(camIt->data[0] < ratioX && camIt->data[2]-camIt->data[0] > ratioX &&
-       camIt->data[1] < ratioY && camIt->data[3]-camIt->data[1] > ratioY)
+    //data is x, y, w, h as fractions of the window
+    if(camIt->data[0] <= ratioX && camIt->data[0]+camIt->data[2] > ratioX &&
+       camIt->data[1] <= ratioY && camIt->data[1]+camIt->data[3] > ratioY)
     {
-      return std::static_pointer_cast<Camera>(camIt->camera).get()->pixelToXY(vec2<float>(pixel[0]*camIt->data[2],pixel[1]*camIt->data[3]));
+      return std::static_pointer_cast<Camera>(camIt->camera).get()->pixelToXY(vec2<float>(pixel[0] - camIt->data[0]*renderTarget->w, pixel[1] - camIt->data[1]*renderTarget->h));
     }
   }
 
@@ -0,0 +1,245 @@
+/*
+ *  FILENAME:      pregen.cpp
+ *
+ *  DESCRIPTION:
+ *      Generates and saves all chunks of a rectangle before anyone plays on the map, e.g. for servers
+ *
+ *  NOTES:
+ *      Writes the same files as the game (data/map/data.dat and data/map/chunks/<x>.<y>.tdat below the map directory -d).
+ *      Chunks that already have a file are skipped, so an interrupted run continues where it stopped when started again.
+ *      An existing map keeps its seed, -s has to match it. New maps get the seed of -s or a random one.
+ *
+ *      usage: blub_pregen -r left,top,right,bottom [-s seed] [-d mapdir] [-j threads] [-z none|lz4]
+ *             the rectangle is in chunk coordinates, both corners included
+ *
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <getopt.h>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "game/filesystem.hpp"
+#include "logic/map.h"
+
+namespace
+{
+  struct Options
+  {
+    std::string mapDir = ".";
+    std::optional<uint32_t> seed;
+    std::optional<compression::Codec> codec;
+    int left = 0;
+    int top = 0;
+    int right = -1;
+    int bottom = -1;
+    // writes wait on the disk more than on the cpu, so a few more threads than cores, like Map::flush
+    unsigned threads = std::max(4u, std::thread::hardware_concurrency());
+  };
+
+  using Clock = std::chrono::steady_clock;
+
+  double secondsSince(Clock::time_point start)
+  {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+  }
+
+  void usage(const char* name)
+  {
+    fprintf(stderr, "usage: %s -r left,top,right,bottom [-s seed] [-d mapdir] [-j threads] [-z none|lz4]\n", name);
+  }
+
+  // whole-string number parsing, strtoul alone takes "12abc", "" and "-1" (as ULONG_MAX)
+  std::optional<unsigned long> parseUnsigned(const char* text, unsigned long max)
+  {
+    if (*text < '0' || *text > '9')
+    {
+      return std::nullopt;
+    }
+    char* end = nullptr;
+    errno = 0;
+    unsigned long value = strtoul(text, &end, 10);
+    if (errno != 0 || *end != '\0' || value > max)
+    {
+      return std::nullopt;
+    }
+    return value;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  Options options;
+  bool hasRect = false;
+
+  int c;
+  while ((c = getopt(argc, argv, "r:s:d:j:z:")) != -1)
+  {
+    switch (c)
+    {
+      case 'r':
+        hasRect = sscanf(optarg, "%d,%d,%d,%d", &options.left, &options.top, &options.right, &options.bottom) == 4;
+        break;
+      case 's':
+      {
+        auto seed = parseUnsigned(optarg, UINT32_MAX);
+        if (!seed)
+        {
+          fprintf(stderr, "invalid seed \"%s\", expected a number from 0 to %u\n", optarg, UINT32_MAX);
+          usage(argv[0]);
+          return EXIT_FAILURE;
+        }
+        options.seed = static_cast<uint32_t>(*seed);
+        break;
+      }
+      case 'd':
+        options.mapDir = optarg;
+        break;
+      case 'j':
+      {
+        auto threads = parseUnsigned(optarg, 1024);
+        if (!threads || *threads == 0)
+        {
+          fprintf(stderr, "invalid thread count \"%s\", expected a number from 1 to 1024\n", optarg);
+          usage(argv[0]);
+          return EXIT_FAILURE;
+        }
+        options.threads = static_cast<unsigned>(*threads);
+        break;
+      }
+      case 'z':
+        if (std::string(optarg) == "none")     options.codec = compression::Codec::None;
+        else if (std::string(optarg) == "lz4") options.codec = compression::Codec::LZ4;
+        else
+        {
+          fprintf(stderr, "unknown codec \"%s\"\n", optarg);
+          return EXIT_FAILURE;
+        }
+        break;
+      default:
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+
+  if (!hasRect || options.right < options.left || options.bottom < options.top)
+  {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  // Map and Chunk use paths relative to the working directory
+  std::error_code error;
+  std::filesystem::create_directories(std::filesystem::path(options.mapDir) / "data/map/chunks", error);
+  if (!error)
+  {
+    std::filesystem::current_path(options.mapDir, error);
+  }
+  if (error)
+  {
+    fprintf(stderr, "[PREGEN] can't use map directory %s: %s\n", options.mapDir.c_str(), error.message().c_str());
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  Map map;
+  if (map.getLoadResult() == Map::LoadResult::Damaged)
+  {
+    auto path = map.getDataFilePath();
+    fprintf(stderr, "[PREGEN] %s/%s is damaged and kept as %s/%s.damaged. Restore it from a backup or pick another map directory\n", options.mapDir.c_str(), path.c_str(), options.mapDir.c_str(), path.c_str());
+    return EXIT_FAILURE;
+  }
+
+  bool existingMap = map.getLoadResult() == Map::LoadResult::Loaded;
+  if (options.seed && existingMap && map.getSeed() != *options.seed)
+  {
+    fprintf(stderr, "[PREGEN] the map in %s was generated with seed %u, not %u\n", options.mapDir.c_str(), map.getSeed(), *options.seed);
+    return EXIT_FAILURE;
+  }
+  if (options.seed && !existingMap)
+  {
+    map.setSeed(*options.seed);
+  }
+  if (options.codec)
+  {
+    map.setChunkCodec(*options.codec);
+  }
+  // writes data.dat now, so an interrupted run leaves the seed behind for the next one
+  map.autosave();
+
+  std::vector<game::vec2<int>> todo;
+  auto total = 0u;
+  for (auto y = options.top; y <= options.bottom; y++)
+  {
+    for (auto x = options.left; x <= options.right; x++)
+    {
+      total++;
+      if (!std::filesystem::exists(Chunk::filePath(game::vec2<int>(x, y))))
+      {
+        todo.push_back(game::vec2<int>(x, y));
+      }
+    }
+  }
+
+  printf("[PREGEN] seed %u, chunks %d,%d to %d,%d: %zu to generate, %u already saved, %u threads\n",
+    map.getSeed(), options.left, options.top, options.right, options.bottom, todo.size(), total - static_cast<unsigned>(todo.size()), options.threads);
+
+  std::atomic<size_t> next { 0 };
+  std::atomic<size_t> done { 0 };
+  std::vector<std::thread> workers;
+  auto start = Clock::now();
+
+  for (auto i = 0u; i < std::min<size_t>(options.threads, todo.size()); i++)
+  {
+    workers.emplace_back(
+      [&]() -> void
+      {
+        for (auto index = next++; index < todo.size(); index = next++)
+        {
+          // generates when constructed. Generated chunks are only written once changed, here they have to be
+          Chunk chunk(todo[index][0], todo[index][1], &map);
+          chunk.saveFull();
+          done++;
+        }
+      }
+    );
+  }
+
+  auto lastReport = Clock::now();
+  while (done < todo.size())
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    if (secondsSince(lastReport) >= 1.)
+    {
+      lastReport = Clock::now();
+      auto finished = done.load();
+      auto rate = finished / secondsSince(start);
+      printf("[PREGEN] %zu/%zu chunks (%.1f %%), %.0f chunks/s, %.0f s left\n",
+        finished, todo.size(), 100. * finished / todo.size(), rate, rate > 0. ? (todo.size() - finished) / rate : 0.);
+      fflush(stdout);
+    }
+  }
+
+  for (auto& worker : workers)
+  {
+    worker.join();
+  }
+
+  auto seconds = secondsSince(start);
+  map.flush();
+
+  printf("[PREGEN] generated %zu chunks in %.1f s (%.0f chunks/s), %.1f MB written\n",
+    todo.size(), seconds, seconds > 0. ? todo.size() / seconds : 0., filesystem::stats.bytesWritten / (1024. * 1024.));
+
+  return EXIT_SUCCESS;
+}